@@ -3,9 +3,15 @@
  *
  *  Created on: Feb 22, 2026
  *      Author: andrea
+ *
+ *  The second track is the input delayed and attenuated, it replaces the
+ *  dry signal when the effect is enabled. Delay, level and enable changes
+ *  go through the smooth module, so live tweaks don't click.
  */
 
 #include "adt.h"
+#include "smooth.h"
+#include <zephyr/sys/util.h>
 #include <math.h>
 #include <string.h>
 
@@ -13,45 +19,70 @@
 
 int32_t adt_buff[ADT_BUFF_SIZE] = {0};
 
-static uint32_t sample_offset = 0;
-static uint16_t index_high = 0;
-static uint16_t index_low = 0;
+struct adt_handler_t
+{
+    struct smooth_delay delay;
+    struct smooth_gain dry; // Input on the second track, unity when disabled
+    struct smooth_gain wet; // Delayed input on the second track
+} static adt_handler;
 
 /**
- * @brief adt_init
+ * @brief adt_delay_samples
  *
  * @param delay_ms
+ * @return uint32_t
  */
-void adt_init(uint16_t delay_ms)
+static inline uint32_t adt_delay_samples(uint16_t delay_ms)
 {
-    sample_offset = ((delay_ms * 44100) / 1000);
+    return (((uint32_t)delay_ms * 44100) / 1000);
 }
 
 /**
- * @brief adt_store_sample
+ * @brief adt_init; effect disabled, delay line cleared
  *
- * @param sample
+ * @param delay_ms
  */
-void adt_store_sample(int32_t sample)
+void adt_init(uint16_t delay_ms)
 {
-    adt_buff[index_high] = sample;
-    index_high = ((index_high + 1) % ADT_BUFF_SIZE);
+    smooth_delay_init(&adt_handler.delay, adt_buff, ADT_BUFF_SIZE, adt_delay_samples(delay_ms));
+    smooth_gain_init(&adt_handler.dry, SMOOTH_GAIN_UNITY);
+    smooth_gain_init(&adt_handler.wet, 0);
 }
 
 /**
- * @brief adt_get_sample
+ * @brief adt_set_delay; crossfaded to the new delay, audio thread only
  *
- * @return int32_t
+ * @param delay_ms
  */
-int32_t adt_get_sample(void)
+void adt_set_delay(uint16_t delay_ms)
 {
-    int32_t sample = 0;
+    smooth_delay_set(&adt_handler.delay, adt_delay_samples(delay_ms));
+}
 
-    if (((index_high - index_low + ADT_BUFF_SIZE) % ADT_BUFF_SIZE) >= sample_offset)
-    {
-        sample = adt_buff[index_low];
-        index_low = ((index_low + 1) % ADT_BUFF_SIZE);
-    }
+/**
+ * @brief adt_set_mix; ramped on the next block, audio thread only
+ *
+ * @param enabled
+ * @param fading_lev delayed track attenuation, 6 dB steps
+ */
+void adt_set_mix(bool enabled, uint8_t fading_lev)
+{
+    smooth_gain_set(&adt_handler.dry, (enabled ? 0 : SMOOTH_GAIN_UNITY));
+    smooth_gain_set(&adt_handler.wet, (enabled ? (SMOOTH_GAIN_UNITY >> MIN(fading_lev, 31)) : 0));
+}
 
-    return sample;
+/**
+ * @brief adt_process; second track of a block
+ *
+ * The line keeps running while disabled, enabling doesn't wait for it to fill.
+ *
+ * @param in
+ * @param out must not be in
+ * @param n
+ */
+void adt_process(const q31_t *in, q31_t *out, uint32_t n)
+{
+    smooth_delay_process(&adt_handler.delay, in, out, n);
+    smooth_gain_apply(&adt_handler.wet, out, out, n);
+    smooth_gain_mac(&adt_handler.dry, in, out, n);
 }
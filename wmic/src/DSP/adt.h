@@ -10,9 +10,11 @@
 
 #include <arm_math.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 void adt_init(uint16_t delay_ms);
-void adt_store_sample(int32_t sample);
-int32_t adt_get_sample(void);
+void adt_set_delay(uint16_t delay_ms);
+void adt_set_mix(bool enabled, uint8_t fading_lev);
+void adt_process(const q31_t *in, q31_t *out, uint32_t n);
 
 #endif /* ADT_H_ */
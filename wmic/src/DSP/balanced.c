@@ -0,0 +1,221 @@
+/*
+ * balanced.c - Pseudo-balanced input from the two ADC channels
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ *
+ *  The hot leg is wired on the right channel and the cold leg on the left
+ *  one, the output is the saturated difference R - L. Hum picked up along
+ *  the cable is common to both legs, so it cancels only as long as the two
+ *  ADC paths have the same gain. During the first blocks after start-up
+ *  (mic at rest, input dominated by common mode noise) the least squares
+ *  ratio between the legs is measured and split on two q31 gain trims.
+ *
+ *  The rejection is the common mode (L + R) / 2 to output energy ratio over
+ *  the same window, where the input is common mode only by assumption. It
+ *  is computed from the window sums, before and after the trims, and held:
+ *  the ratio on live input would be a signal to hum ratio, not a CMRR.
+ */
+
+#include "balanced.h"
+#include <zephyr/sys/atomic.h>
+#include <string.h>
+
+#define BALANCED_ACC_SHIFT 8    // Samples pre-shift for the q63 accumulators
+#define BALANCED_CMRR_MAX_DB 99 // Reported when the output energy is zero
+
+struct balanced_handler_t
+{
+    q31_t trim_l; // Left gain correction, gain = 1 + trim
+    q31_t trim_r; // Right gain correction, gain = 1 + trim
+    bool trimmed;
+
+    // Calibration
+    uint32_t cal_blocks;
+    atomic_t cal_count; // Published after the calibration results
+    q63_t sll; // sum(L * L)
+    q63_t slr; // sum(L * R)
+    q63_t srr; // sum(R * R)
+    int16_t cmrr_raw_db;
+    int16_t cmrr_db;
+} static balanced_handler;
+
+static inline q31_t balanced_trim(q31_t x, q31_t trim);
+static void balanced_calibrate(void);
+static int16_t balanced_cmrr_db(float32_t gl, float32_t gr);
+static int16_t balanced_ratio_db(float32_t num, float32_t den);
+
+/**
+ * @brief balanced_init
+ *
+ * @param cal_blocks number of blocks used to calibrate the gain trim
+ */
+void balanced_init(uint32_t cal_blocks)
+{
+    memset(&balanced_handler, 0, sizeof(balanced_handler));
+    balanced_handler.cal_blocks = cal_blocks;
+}
+
+/**
+ * @brief balanced_process; interleaved stereo block to mono difference
+ *
+ * @param pmem
+ * @param mono
+ * @param frames
+ */
+void balanced_process(const int32_t *pmem, q31_t *mono, uint32_t frames)
+{
+    q31_t trim_l = balanced_handler.trim_l;
+    q31_t trim_r = balanced_handler.trim_r;
+    bool cal = (atomic_get(&balanced_handler.cal_count) < balanced_handler.cal_blocks);
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        q31_t l = pmem[2 * i];
+        q31_t r = pmem[(2 * i) + 1];
+
+        if (cal)
+        {
+            q31_t ls = (l >> BALANCED_ACC_SHIFT);
+            q31_t rs = (r >> BALANCED_ACC_SHIFT);
+
+            balanced_handler.sll += ((q63_t)ls * ls);
+            balanced_handler.slr += ((q63_t)ls * rs);
+            balanced_handler.srr += ((q63_t)rs * rs);
+        }
+
+        l = balanced_trim(l, trim_l);
+        r = balanced_trim(r, trim_r);
+
+        mono[i] = __QSUB(r, l); // right - left
+    }
+
+    if (cal)
+    {
+        if ((atomic_get(&balanced_handler.cal_count) + 1) == balanced_handler.cal_blocks)
+        {
+            balanced_calibrate();
+        }
+        atomic_inc(&balanced_handler.cal_count);
+    }
+}
+
+/**
+ * @brief balanced_get_status; values are written once by the audio thread, at the end of the calibration
+ *
+ * @param status
+ */
+void balanced_get_status(struct balanced_status *status)
+{
+    status->calibrated = (atomic_get(&balanced_handler.cal_count) >= balanced_handler.cal_blocks);
+    if (!status->calibrated)
+    {
+        memset(status, 0, sizeof(*status));
+        return;
+    }
+
+    status->trimmed = balanced_handler.trimmed;
+    status->trim_l_ppm = (int32_t)(((q63_t)balanced_handler.trim_l * 1000000) >> 31);
+    status->trim_r_ppm = (int32_t)(((q63_t)balanced_handler.trim_r * 1000000) >> 31);
+    status->cmrr_raw_db = balanced_handler.cmrr_raw_db;
+    status->cmrr_db = balanced_handler.cmrr_db;
+}
+
+/**
+ * @brief balanced_trim; x * (1 + trim), saturated
+ *
+ * @param x
+ * @param trim
+ * @return q31_t
+ */
+static inline q31_t balanced_trim(q31_t x, q31_t trim)
+{
+    return __QADD(x, (q31_t)(((q63_t)x * trim) >> 31));
+}
+
+/**
+ * @brief balanced_calibrate; least squares gain match between the legs
+ *
+ * The ratio g = sum(L * R) / sum(L * L) minimises sum((R - g * L)^2), it is
+ * split as gl = 2g / (1 + g) and gr = 2 / (1 + g) so that gl / gr = g and
+ * the overall level is preserved. Both rejections are evaluated on the
+ * window sums, the trimmed one with the gains actually applied.
+ *
+ * The results are written before cal_count reaches cal_blocks, so a reader
+ * seeing the calibration done sees the final values.
+ */
+static void balanced_calibrate(void)
+{
+    float32_t sll = (float32_t)balanced_handler.sll;
+    float32_t slr = (float32_t)balanced_handler.slr;
+
+    balanced_handler.cmrr_raw_db = balanced_cmrr_db(1.0f, 1.0f);
+    balanced_handler.cmrr_db = balanced_handler.cmrr_raw_db;
+
+    if ((sll <= 0.0f) || (slr <= 0.0f))
+    {
+        return; // No common mode signal to match the legs on
+    }
+
+    float32_t g = (slr / sll);
+    float32_t gl = ((2.0f * g) / (1.0f + g));
+    float32_t gr = (2.0f / (1.0f + g));
+
+    if ((fabsf(gl - 1.0f) > BALANCED_MAX_TRIM) || (fabsf(gr - 1.0f) > BALANCED_MAX_TRIM))
+    {
+        return; // Legs too different, not common mode noise
+    }
+
+    balanced_handler.trim_l = (q31_t)((gl - 1.0f) * 2147483648.0f);
+    balanced_handler.trim_r = (q31_t)((gr - 1.0f) * 2147483648.0f);
+    balanced_handler.trimmed = true;
+    balanced_handler.cmrr_db = balanced_cmrr_db(gl, gr);
+}
+
+/**
+ * @brief balanced_cmrr_db; common mode to output energy over the calibration window, legs scaled by gl and gr
+ *
+ * @param gl
+ * @param gr
+ * @return int16_t
+ */
+static int16_t balanced_cmrr_db(float32_t gl, float32_t gr)
+{
+    float32_t sll = ((float32_t)balanced_handler.sll * gl * gl);
+    float32_t slr = ((float32_t)balanced_handler.slr * gl * gr);
+    float32_t srr = ((float32_t)balanced_handler.srr * gr * gr);
+
+    return balanced_ratio_db(((sll + (2.0f * slr) + srr) / 4.0f), (sll - (2.0f * slr) + srr));
+}
+
+/**
+ * @brief balanced_ratio_db
+ *
+ * @param num
+ * @param den
+ * @return int16_t
+ */
+static int16_t balanced_ratio_db(float32_t num, float32_t den)
+{
+    if (num <= 0.0f)
+    {
+        return 0;
+    }
+    if (den <= 0.0f)
+    {
+        return BALANCED_CMRR_MAX_DB;
+    }
+
+    float32_t db = (10.0f * log10f(num / den));
+
+    if (db > BALANCED_CMRR_MAX_DB)
+    {
+        db = BALANCED_CMRR_MAX_DB;
+    }
+    else if (db < -BALANCED_CMRR_MAX_DB)
+    {
+        db = -BALANCED_CMRR_MAX_DB;
+    }
+
+    return (int16_t)db;
+}
@@ -0,0 +1,31 @@
+/*
+ * balanced.h - Pseudo-balanced input from the two ADC channels
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ */
+
+#ifndef BALANCED_H_
+#define BALANCED_H_
+
+#include <arm_math.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BALANCED_MAX_TRIM 0.1f // Maximum gain correction per leg (10%)
+
+struct balanced_status
+{
+    bool calibrated;     // Calibration window elapsed
+    bool trimmed;        // Gain trim applied (calibration data usable)
+    int32_t trim_l_ppm;  // Left leg gain correction
+    int32_t trim_r_ppm;  // Right leg gain correction
+    int16_t cmrr_raw_db; // Rejection over the calibration window, without trim
+    int16_t cmrr_db;     // Rejection over the calibration window, with the trim applied
+};
+
+void balanced_init(uint32_t cal_blocks);
+void balanced_process(const int32_t *pmem, q31_t *mono, uint32_t frames);
+void balanced_get_status(struct balanced_status *status);
+
+#endif /* BALANCED_H_ */
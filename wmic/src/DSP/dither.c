@@ -0,0 +1,152 @@
+/*
+ * dither.c - Dither and noise shaping to the 16 bit output window
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ *
+ *  The bt module considers only the 16 higher bits of each 32 bit I2S word.
+ *  Each q31 sample gets the shaped quantization error of the previous
+ *  samples subtracted, then TPDF dither (sum of two uniform values of one
+ *  16 bit LSB each) is added before the truncation of the 16 lower bits.
+ *  The dither is generated a block at a time and the truncation is one
+ *  arm_and_u32 mask pass. Without a shaper the dither add is a block op
+ *  too; with one (DITHER_SHAPER_2ND by default) the error feedback
+ *  recursion makes the add per sample.
+ */
+
+#include "dither.h"
+#include <zephyr/sys/util.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define DITHER_OUT_BITS 16
+#define DITHER_LSB_SHIFT (32 - DITHER_OUT_BITS)
+#define DITHER_MASK (~((1u << DITHER_LSB_SHIFT) - 1u))
+#define DITHER_HALF_LSB (1 << (DITHER_LSB_SHIFT - 1))
+#define DITHER_BLOCK 128 // Samples, even to keep the channel alternation
+
+struct dither_handler_t
+{
+    enum dither_shaper_e shaper;
+    uint32_t rng;
+    q31_t err1[DITHER_CHANNELS]; // Quantization error at n - 1
+    q31_t err2[DITHER_CHANNELS]; // Quantization error at n - 2
+} static dither_handler;
+
+static q31_t dither_noise[DITHER_BLOCK];
+static uint32_t dither_mask[DITHER_BLOCK];
+
+static void dither_noise_fill(uint32_t len);
+static void dither_feedback(q31_t *blk, uint32_t len);
+static inline uint32_t dither_rand(void);
+
+/**
+ * @brief dither_init
+ *
+ * @param shaper
+ */
+void dither_init(enum dither_shaper_e shaper)
+{
+    memset(&dither_handler, 0, sizeof(dither_handler));
+    dither_handler.shaper = shaper;
+    dither_handler.rng = 0x2545F491;
+
+    for (uint32_t i = 0; i < DITHER_BLOCK; i++)
+    {
+        dither_mask[i] = DITHER_MASK;
+    }
+}
+
+/**
+ * @brief dither_process; interleaved stereo block, in place
+ *
+ * @param pmem
+ * @param frames
+ */
+void dither_process(int32_t *pmem, uint32_t frames)
+{
+    uint32_t n = (frames * DITHER_CHANNELS);
+
+    for (uint32_t i = 0; i < n; i += DITHER_BLOCK)
+    {
+        uint32_t len = MIN((n - i), DITHER_BLOCK);
+        q31_t *blk = &pmem[i];
+
+        dither_noise_fill(len);
+
+        if (dither_handler.shaper == DITHER_SHAPER_NONE)
+        {
+            // No recursion, dither add as a block
+            arm_add_q31(blk, dither_noise, blk, len);
+        }
+        else
+        {
+            dither_feedback(blk, len);
+        }
+
+        // Truncation of the 16 lower bits, towards minus infinity as the rounding offset expects
+        arm_and_u32((uint32_t *)blk, dither_mask, (uint32_t *)blk, len);
+    }
+}
+
+/**
+ * @brief dither_noise_fill; TPDF dither plus the rounding offset
+ *
+ * @param len
+ */
+static void dither_noise_fill(uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        // Two uniform values in [-LSB/2, LSB/2) from one draw
+        uint32_t r = dither_rand();
+
+        dither_noise[i] = ((q31_t)(r << 16) >> DITHER_LSB_SHIFT) + ((q31_t)(r & 0xFFFF0000u) >> DITHER_LSB_SHIFT) + DITHER_HALF_LSB;
+    }
+}
+
+/**
+ * @brief dither_feedback; error feedback and dither add, leaves the value to truncate
+ *
+ * The error of each sample depends on the previous outputs, only this
+ * recursion stays per sample.
+ *
+ * @param blk interleaved, starts on the left channel
+ * @param len
+ */
+static void dither_feedback(q31_t *blk, uint32_t len)
+{
+    bool second = (dither_handler.shaper == DITHER_SHAPER_2ND);
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        uint32_t ch = (i & 1u);
+        q31_t e1 = dither_handler.err1[ch];
+        q31_t fb = second ? ((2 * e1) - dither_handler.err2[ch]) : e1;
+
+        // |e| < 1.5 LSB (TPDF dither plus truncation), so |fb| < 4.5 LSB: 2 * e1 can't overflow,
+        // only a sample at full scale is clipped by the saturating ops
+        q31_t x = __QSUB(blk[i], fb);
+        q31_t v = __QADD(x, dither_noise[i]);
+
+        dither_handler.err2[ch] = e1;
+        dither_handler.err1[ch] = ((q31_t)((uint32_t)v & DITHER_MASK) - x); // Total error (dither included) seen by the shaper
+
+        blk[i] = v;
+    }
+}
+
+/**
+ * @brief dither_rand; xorshift32
+ *
+ * @return uint32_t
+ */
+static inline uint32_t dither_rand(void)
+{
+    uint32_t x = dither_handler.rng;
+    x ^= (x << 13);
+    x ^= (x >> 17);
+    x ^= (x << 5);
+    dither_handler.rng = x;
+    return x;
+}
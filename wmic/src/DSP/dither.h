@@ -0,0 +1,26 @@
+/*
+ * dither.h - Dither and noise shaping to the 16 bit output window
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ */
+
+#ifndef DITHER_H_
+#define DITHER_H_
+
+#include <arm_math.h>
+#include <stdint.h>
+
+#define DITHER_CHANNELS 2
+
+enum dither_shaper_e
+{
+    DITHER_SHAPER_NONE = 0, // Plain TPDF dither
+    DITHER_SHAPER_1ST,      // First order error feedback, E(z) = 1 - z^-1
+    DITHER_SHAPER_2ND,      // Second order error feedback, E(z) = (1 - z^-1)^2
+};
+
+void dither_init(enum dither_shaper_e shaper);
+void dither_process(int32_t *pmem, uint32_t frames);
+
+#endif /* DITHER_H_ */
@@ -0,0 +1,96 @@
+/*
+ * dsp_prof.c - DSP stages cycle profiler
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ */
+
+#include "dsp_prof.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/sys/printk.h>
+
+#include <string.h>
+
+#define DSP_PROF_AVG_SHIFT 4 // Moving average weight (1/16)
+
+static const char *const dsp_prof_names[DSP_PROF_NUM] = {
+    "ELAB",
+    "CHAIN",
+    "DITHER",
+};
+
+static timing_t dsp_prof_start_time[DSP_PROF_NUM];
+static struct dsp_prof_stats dsp_prof_stats[DSP_PROF_NUM];
+
+/**
+ * @brief dsp_prof_init
+ *
+ */
+void dsp_prof_init(void)
+{
+    timing_init();
+    timing_start();
+    memset(dsp_prof_stats, 0, sizeof(dsp_prof_stats));
+}
+
+/**
+ * @brief dsp_prof_start
+ *
+ * @param stage
+ */
+void dsp_prof_start(enum dsp_prof_stage_e stage)
+{
+    dsp_prof_start_time[stage] = timing_counter_get();
+}
+
+/**
+ * @brief dsp_prof_stop
+ *
+ * @param stage
+ */
+void dsp_prof_stop(enum dsp_prof_stage_e stage)
+{
+    timing_t end = timing_counter_get();
+    struct dsp_prof_stats *s = &dsp_prof_stats[stage];
+    uint32_t cycles = (uint32_t)timing_cycles_get(&dsp_prof_start_time[stage], &end);
+
+    s->last = cycles;
+    s->max = (cycles > s->max) ? cycles : s->max;
+    if (s->count == 0)
+    {
+        s->avg = cycles;
+    }
+    else
+    {
+        s->avg = (uint32_t)((int32_t)s->avg + (((int32_t)cycles - (int32_t)s->avg) >> DSP_PROF_AVG_SHIFT));
+    }
+    s->count++;
+}
+
+/**
+ * @brief dsp_prof_report; print the per block cost of every measured stage
+ *
+ */
+void dsp_prof_report(void)
+{
+    uint32_t mhz = timing_freq_get_mhz();
+
+    for (int i = 0; i < DSP_PROF_NUM; i++)
+    {
+        const struct dsp_prof_stats *s = &dsp_prof_stats[i];
+
+        if (s->count == 0)
+        {
+            continue;
+        }
+
+        printk("DSP %s: avg %u cyc (%u us), max %u cyc, blocks %u\n",
+               dsp_prof_names[i],
+               s->avg,
+               (mhz > 0) ? (s->avg / mhz) : 0,
+               s->max,
+               s->count);
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * dsp_prof.h - DSP stages cycle profiler
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ */
+
+#ifndef DSP_PROF_H_
+#define DSP_PROF_H_
+
+#include <stdint.h>
+
+enum dsp_prof_stage_e
+{
+    DSP_PROF_ELAB = 0, // Whole data_elab() block
+    DSP_PROF_CHAIN,    // Amplifier, filter and effects chain
+    DSP_PROF_DITHER,   // Dither and noise shaping
+    DSP_PROF_NUM
+};
+
+struct dsp_prof_stats
+{
+    uint32_t last;  // Cycles spent in the last block
+    uint32_t max;   // Worst case cycles per block
+    uint32_t avg;   // Moving average of cycles per block
+    uint32_t count; // Number of measured blocks
+};
+
+void dsp_prof_init(void);
+void dsp_prof_start(enum dsp_prof_stage_e stage);
+void dsp_prof_stop(enum dsp_prof_stage_e stage);
+void dsp_prof_report(void);
+
+#endif /* DSP_PROF_H_ */
@@ -0,0 +1,251 @@
+/*
+ * latency.c - Round trip latency measurement
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ *
+ *  A MLS burst from the signal generator replaces the left input channel at
+ *  the head of the processing chain, so it leaves on TX. With a loopback
+ *  cable it comes back on RX: the raw input is captured and
+ *  cross-correlated with the burst, the lag of the correlation peak is the
+ *  whole RX -> chain -> TX -> RX delay. The time each block spends between
+ *  the chain input and the TX queue is measured with the cycle counter. The
+ *  I2S part comes from the frames in flight in the RX and TX queues, it's
+ *  known without the cable; the loop adds the converters and the wiring.
+ *  The correlation (~3.6M MAC) runs on its own low priority work queue.
+ *
+ *  The burst comes from the signal generator, the measurement can't be
+ *  built together with ENABLE_SIGNAL_GEN.
+ */
+
+#include "latency.h"
+#include "signals.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include <string.h>
+
+#define LATENCY_CAPTURE_LEN 4096 // Captured samples (~93ms at 44.1kHz)
+#define LATENCY_MLS_AMP 0.25f
+#define LATENCY_DETECT_RATIO 8 // Correlation peak over the mean correlation magnitude
+#define LATENCY_WQ_STACK (1024)
+#define LATENCY_WQ_PRIORITY 14 // Below every application thread, only delays the result
+
+enum latency_state_e
+{
+    LATENCY_IDLE = 0,
+    LATENCY_ARMED,
+    LATENCY_RUNNING,
+    LATENCY_ANALYZE,
+};
+
+struct latency_handler_t
+{
+    uint32_t fs;
+    latency_done_cb cb;
+    atomic_t state;
+    int64_t start_ms;
+    uint32_t in_idx;
+    uint32_t block_cyc;    // Chain input time of the running block
+    uint32_t proc_max_cyc; // Worst chain input to TX queue time of the run
+    struct latency_result result;
+} static latency_handler;
+
+static q31_t latency_ref[SIGNALS_MLS_LEN];
+static q31_t latency_cap_in[LATENCY_CAPTURE_LEN];
+
+static void latency_work_handler(struct k_work *work);
+static int32_t latency_find_lag(const q31_t *cap);
+
+K_WORK_DEFINE(latency_work, latency_work_handler);
+K_THREAD_STACK_DEFINE(latency_wq_stack, LATENCY_WQ_STACK);
+static struct k_work_q latency_wq;
+
+/**
+ * @brief latency_init
+ *
+ * @param fs
+ * @param io_frames frames in flight in the I2S queues
+ * @param cb called from the latency work queue
+ */
+void latency_init(uint32_t fs, uint32_t io_frames, latency_done_cb cb)
+{
+    latency_handler.fs = fs;
+    latency_handler.cb = cb;
+    latency_handler.result.io_us = (int32_t)(((uint64_t)io_frames * 1000000) / fs);
+    atomic_set(&latency_handler.state, LATENCY_IDLE);
+
+    k_work_queue_start(&latency_wq, latency_wq_stack, K_THREAD_STACK_SIZEOF(latency_wq_stack), LATENCY_WQ_PRIORITY, NULL);
+}
+
+/**
+ * @brief latency_start; the burst is injected from the next audio block
+ *
+ * A run stuck without audio blocks (link lost, stream stopped) is dropped
+ * after LATENCY_TIMEOUT_MS.
+ *
+ * @return int
+ */
+int latency_start(void)
+{
+    if (latency_handler.fs == 0)
+    {
+        return -ENODEV;
+    }
+
+    atomic_val_t state = atomic_get(&latency_handler.state);
+
+    if (state != LATENCY_IDLE)
+    {
+        if ((state == LATENCY_ANALYZE) || ((k_uptime_get() - latency_handler.start_ms) < LATENCY_TIMEOUT_MS))
+        {
+            return -EBUSY;
+        }
+        if (!atomic_cas(&latency_handler.state, state, LATENCY_IDLE))
+        {
+            return -EBUSY; // The audio thread moved it meanwhile
+        }
+    }
+
+    struct signals_cfg cfg = {
+        .fs = latency_handler.fs,
+        .tones_n = 1,
+        .tone[0] = {.wave = SIG_WAVE_MLS, .freq = 0.0f, .amp = LATENCY_MLS_AMP},
+        .sweep = SIG_SWEEP_NONE,
+    };
+
+    if (signals_init(&cfg) < 0)
+    {
+        return -EINVAL;
+    }
+    signals_fill_mono(latency_ref, SIGNALS_MLS_LEN);
+    signals_init(&cfg); // Restart the sequence for the injection
+
+    latency_handler.in_idx = 0;
+    latency_handler.proc_max_cyc = 0;
+    latency_handler.start_ms = k_uptime_get();
+    atomic_set(&latency_handler.state, LATENCY_ARMED);
+
+    return 0;
+}
+
+/**
+ * @brief latency_process_input; capture the raw input and inject the burst (audio thread)
+ *
+ * @param pmem
+ * @param frames
+ */
+void latency_process_input(int32_t *pmem, uint32_t frames)
+{
+    atomic_val_t state = atomic_get(&latency_handler.state);
+
+    if (state == LATENCY_ARMED)
+    {
+        atomic_set(&latency_handler.state, LATENCY_RUNNING);
+    }
+    else if (state != LATENCY_RUNNING)
+    {
+        return;
+    }
+
+    latency_handler.block_cyc = k_cycle_get_32();
+
+    for (uint32_t i = 0; (i < frames) && (latency_handler.in_idx < LATENCY_CAPTURE_LEN); i++)
+    {
+        uint32_t n = latency_handler.in_idx++;
+
+        latency_cap_in[n] = pmem[(2 * i)];
+        pmem[(2 * i)] = (n < SIGNALS_MLS_LEN) ? latency_ref[n] : 0;
+    }
+}
+
+/**
+ * @brief latency_process_output; block done, about to be queued on TX (audio thread)
+ *
+ */
+void latency_process_output(void)
+{
+    if (atomic_get(&latency_handler.state) != LATENCY_RUNNING)
+    {
+        return;
+    }
+
+    uint32_t cyc = (k_cycle_get_32() - latency_handler.block_cyc);
+
+    latency_handler.proc_max_cyc = MAX(latency_handler.proc_max_cyc, cyc);
+
+    if (latency_handler.in_idx >= LATENCY_CAPTURE_LEN)
+    {
+        // Correlation is too heavy for the audio thread and for the system work queue
+        atomic_set(&latency_handler.state, LATENCY_ANALYZE);
+        k_work_submit_to_queue(&latency_wq, &latency_work);
+    }
+}
+
+/**
+ * @brief latency_work_handler
+ *
+ * @param work
+ */
+static void latency_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    int32_t lag = latency_find_lag(latency_cap_in);
+    uint32_t fs = latency_handler.fs;
+
+    latency_handler.result.proc_us = (int32_t)k_cyc_to_us_floor32(latency_handler.proc_max_cyc);
+    if (lag >= 0)
+    {
+        latency_handler.result.loop_us = (int32_t)(((int64_t)lag * 1000000) / fs);
+    }
+    else
+    {
+        latency_handler.result.loop_us = LATENCY_NOT_DETECTED;
+    }
+
+    atomic_set(&latency_handler.state, LATENCY_IDLE);
+
+    if (latency_handler.cb != NULL)
+    {
+        latency_handler.cb(&latency_handler.result);
+    }
+}
+
+/**
+ * @brief latency_find_lag; cross-correlation peak search
+ *
+ * @param cap
+ * @return int32_t lag in samples, LATENCY_NOT_DETECTED if no clear peak
+ */
+static int32_t latency_find_lag(const q31_t *cap)
+{
+    q63_t peak = 0;
+    q63_t sum = 0;
+    int32_t lag = LATENCY_NOT_DETECTED;
+    uint32_t lags = (LATENCY_CAPTURE_LEN - SIGNALS_MLS_LEN + 1);
+
+    for (uint32_t l = 0; l < lags; l++)
+    {
+        q63_t c;
+
+        arm_dot_prod_q31(&cap[l], latency_ref, SIGNALS_MLS_LEN, &c);
+        c = (c < 0) ? -c : c; // The chain may invert the polarity (stereo diff)
+        sum += (c / lags);
+
+        if (c > peak)
+        {
+            peak = c;
+            lag = (int32_t)l;
+        }
+    }
+
+    if ((sum == 0) || (peak < (LATENCY_DETECT_RATIO * sum)))
+    {
+        return LATENCY_NOT_DETECTED;
+    }
+
+    return lag;
+}
@@ -0,0 +1,32 @@
+/*
+ * latency.h - Round trip latency measurement
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <arm_math.h>
+#include <stdint.h>
+
+#define LATENCY_NOT_DETECTED (-1)
+
+#define LATENCY_TIMEOUT_MS 1000 // A run not completed within this time is dropped by the next start
+
+struct latency_result
+{
+    int32_t proc_us; // Chain input to TX queue, worst block of the run
+    int32_t loop_us; // Burst injected at RX back on RX through TX and the loopback cable, LATENCY_NOT_DETECTED if missing
+    int32_t io_us;   // RX and TX queues depth, I2S and processing latency without converters, always known
+};
+
+typedef void (*latency_done_cb)(const struct latency_result *res); // Callback function for measurement completed
+
+void latency_init(uint32_t fs, uint32_t io_frames, latency_done_cb cb);
+int latency_start(void);
+void latency_process_input(int32_t *pmem, uint32_t frames);
+void latency_process_output(void);
+
+#endif /* LATENCY_H_ */
@@ -50,3 +50,19 @@ void lowpass_filter_exc(q15_t *input, q15_t *out)
 {
 	arm_fir_q15(&lowpass_filter_instance, input, out, filter_block_len);
 }
+
+/**
+ * @brief lowpass_filter_exc_block
+ * 
+ * @param input 
+ * @param out 
+ * @param len number of samples, up to the block_len set at init
+ */
+void lowpass_filter_exc_block(q15_t *input, q15_t *out, uint16_t len)
+{
+	if (len > filter_block_len)
+	{
+		len = filter_block_len;
+	}
+	arm_fir_q15(&lowpass_filter_instance, input, out, len);
+}
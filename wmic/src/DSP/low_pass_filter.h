@@ -14,5 +14,6 @@
 
 void lowpass_filter_init(uint16_t block_len);
 void lowpass_filter_exc(q15_t *input, q15_t *out);
+void lowpass_filter_exc_block(q15_t *input, q15_t *out, uint16_t len);
 
 #endif /* LOW_PASS_FILTER_H_ */
@@ -0,0 +1,68 @@
+/*
+ * param_snap.c - Lock-free parameter snapshots from the UI to the audio thread
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ *
+ *  Triple buffer: the writer fills its back slot and swaps it with the
+ *  middle one, the reader swaps the middle slot with its front one when it
+ *  has been refreshed. Each swap is a single atomic exchange, so neither
+ *  side waits or retries and the reader never sees a block being written.
+ *  Every publish bumps a generation counter stored with the block, the
+ *  reader compares it with the last one it applied to run the one-time
+ *  work of a change (e.g. moving a delay tap) only once.
+ */
+
+#include "param_snap.h"
+
+#include <string.h>
+
+#define PARAM_SNAP_IDX_MASK 0x03
+#define PARAM_SNAP_FRESH 0x04 // Middle slot holds a block the reader hasn't taken yet
+
+/**
+ * @brief param_snap_publish; writer side, copies and publishes a full block
+ *
+ * @param snap
+ * @param params
+ * @return uint32_t generation of the published block
+ */
+uint32_t param_snap_publish(struct param_snap *snap, const void *params)
+{
+    uint8_t back = snap->back;
+
+    memcpy(&snap->buf[back * snap->size], params, snap->size);
+    snap->gen[back] = ++snap->gen_last;
+
+    // Hand the block over, the previous middle slot becomes the new back one
+    atomic_val_t old = atomic_set(&snap->middle, (back | PARAM_SNAP_FRESH));
+    snap->back = (uint8_t)(old & PARAM_SNAP_IDX_MASK);
+
+    return snap->gen[back];
+}
+
+/**
+ * @brief param_snap_read; reader side, newest published block
+ *
+ * The block stays valid and unchanged until the next call from the reader.
+ *
+ * @param snap
+ * @param gen generation of the returned block
+ * @return const void* NULL if nothing has been published yet
+ */
+const void *param_snap_read(struct param_snap *snap, uint32_t *gen)
+{
+    if (atomic_get(&snap->middle) & PARAM_SNAP_FRESH)
+    {
+        atomic_val_t old = atomic_set(&snap->middle, snap->front);
+        snap->front = (uint8_t)(old & PARAM_SNAP_IDX_MASK);
+    }
+
+    *gen = snap->gen[snap->front];
+    if (*gen == 0)
+    {
+        return NULL;
+    }
+
+    return &snap->buf[snap->front * snap->size];
+}
@@ -0,0 +1,43 @@
+/*
+ * param_snap.h - Lock-free parameter snapshots from the UI to the audio thread
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ */
+
+#ifndef PARAM_SNAP_H_
+#define PARAM_SNAP_H_
+
+#include <zephyr/kernel.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PARAM_SNAP_SLOTS 3
+
+struct param_snap
+{
+    uint8_t *buf;                     // PARAM_SNAP_SLOTS blocks of size bytes
+    size_t size;
+    uint32_t gen[PARAM_SNAP_SLOTS];   // Generation of the block in each slot, 0 = never written
+    atomic_t middle;                  // Slot exchanged between the two sides, plus fresh flag
+    uint8_t back;                     // Writer slot
+    uint8_t front;                    // Reader slot
+    uint32_t gen_last;                // Last published generation
+};
+
+// One writer and one reader per channel, type is the parameters block
+#define PARAM_SNAP_DEFINE(name, type)                                          \
+    static uint8_t name##_buf[PARAM_SNAP_SLOTS * sizeof(type)] __aligned(4);  \
+    static struct param_snap name = {                                          \
+        .buf = name##_buf,                                                     \
+        .size = sizeof(type),                                                  \
+        .middle = ATOMIC_INIT(1),                                              \
+        .back = 0,                                                             \
+        .front = 2,                                                            \
+    }
+
+uint32_t param_snap_publish(struct param_snap *snap, const void *params);
+const void *param_snap_read(struct param_snap *snap, uint32_t *gen);
+
+#endif /* PARAM_SNAP_H_ */
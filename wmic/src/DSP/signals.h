@@ -11,8 +11,46 @@
 #include <stdint.h>
 #include "arm_math.h"
 
-#define SIG_GEN_LEN 441
+#define SIGNALS_MAX_TONES 4
+#define SIGNALS_MLS_LEN 511 // 9 bit LFSR
 
-float32_t signals_get_sample(void);
+enum signals_wave_e
+{
+    SIG_WAVE_SINE = 0,
+    SIG_WAVE_SQUARE,
+    SIG_WAVE_SAW,
+    SIG_WAVE_TRIANGLE,
+    SIG_WAVE_WHITE,
+    SIG_WAVE_PINK,
+    SIG_WAVE_MLS, // Maximum length sequence, SIGNALS_MLS_LEN samples period
+};
+
+enum signals_sweep_e
+{
+    SIG_SWEEP_NONE = 0,
+    SIG_SWEEP_LIN,
+    SIG_SWEEP_LOG,
+};
+
+struct signals_tone
+{
+    enum signals_wave_e wave;
+    float32_t freq; // Hz (ignored by noise)
+    float32_t amp;  // 0.0 to 1.0
+};
+
+struct signals_cfg
+{
+    uint32_t fs;
+    uint8_t tones_n; // Tones summed together (multi-tone)
+    struct signals_tone tone[SIGNALS_MAX_TONES];
+    enum signals_sweep_e sweep; // Sweep applied to the first tone
+    float32_t sweep_freq_end;
+    uint32_t sweep_ms;
+};
+
+int signals_init(const struct signals_cfg *cfg);
+void signals_fill_block(int32_t *pmem, uint32_t frames);
+void signals_fill_mono(q31_t *out, uint32_t len);
 
 #endif /* SIGNALS_H_ */
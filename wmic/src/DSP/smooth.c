@@ -0,0 +1,255 @@
+/*
+ * smooth.c - Zipper-free gain and delay changes
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ *
+ *  Gains are set once per block and reach the new value with a linear
+ *  ramp across the block, a steady gain goes through arm_scale_q31. Delay
+ *  changes are never a jump of the read index: the line is read by the
+ *  old and the new tap together and the two are crossfaded over
+ *  SMOOTH_XFADE_LEN samples. Ramps and fades are written chunk by chunk
+ *  in a gain vector on the stack and applied with arm_mult_q31 and
+ *  arm_add_q31, the only per-sample loop left is the ramp itself.
+ */
+
+#include "smooth.h"
+
+#include <zephyr/sys/util.h>
+
+#include <string.h>
+
+#define SMOOTH_XFADE_STEP (SMOOTH_GAIN_UNITY / SMOOTH_XFADE_LEN)
+
+static q31_t smooth_ramp(q31_t gain, q31_t step, q31_t *ramp, uint32_t n);
+static void smooth_delay_write(struct smooth_delay *d, const q31_t *in, uint32_t n);
+static void smooth_delay_read(const struct smooth_delay *d, uint32_t pos, uint32_t delay, q31_t *out, uint32_t n);
+
+/**
+ * @brief smooth_gain_init
+ *
+ * @param g
+ * @param gain
+ */
+void smooth_gain_init(struct smooth_gain *g, q31_t gain)
+{
+    g->cur = gain;
+    g->target = gain;
+}
+
+/**
+ * @brief smooth_gain_set; reached at the end of the next block
+ *
+ * @param g
+ * @param gain
+ */
+void smooth_gain_set(struct smooth_gain *g, q31_t gain)
+{
+    g->target = gain;
+}
+
+/**
+ * @brief smooth_gain_apply; out = in * gain
+ *
+ * @param g
+ * @param in
+ * @param out can be in
+ * @param n
+ */
+void smooth_gain_apply(struct smooth_gain *g, const q31_t *in, q31_t *out, uint32_t n)
+{
+    if ((g->cur == g->target) || (n == 0))
+    {
+        arm_scale_q31(in, g->cur, 0, out, n);
+        return;
+    }
+
+    q31_t step = (q31_t)(((q63_t)g->target - g->cur) / (q63_t)n);
+    q31_t gain = g->cur;
+    q31_t ramp[SMOOTH_GAIN_CHUNK];
+
+    for (uint32_t done = 0; done < n; done += SMOOTH_GAIN_CHUNK)
+    {
+        uint32_t len = MIN(SMOOTH_GAIN_CHUNK, (n - done));
+
+        gain = smooth_ramp(gain, step, ramp, len);
+        arm_mult_q31(&in[done], ramp, &out[done], len);
+    }
+
+    g->cur = g->target;
+}
+
+/**
+ * @brief smooth_gain_mac; acc += in * gain, saturated
+ *
+ * @param g
+ * @param in
+ * @param acc
+ * @param n
+ */
+void smooth_gain_mac(struct smooth_gain *g, const q31_t *in, q31_t *acc, uint32_t n)
+{
+    if ((g->cur == 0) && (g->target == 0))
+    {
+        return;
+    }
+
+    q31_t step = ((n > 0) ? (q31_t)(((q63_t)g->target - g->cur) / (q63_t)n) : 0);
+    q31_t gain = g->cur;
+    q31_t ramp[SMOOTH_GAIN_CHUNK];
+    q31_t prod[SMOOTH_GAIN_CHUNK];
+
+    for (uint32_t done = 0; done < n; done += SMOOTH_GAIN_CHUNK)
+    {
+        uint32_t len = MIN(SMOOTH_GAIN_CHUNK, (n - done));
+
+        if (g->cur == g->target)
+        {
+            arm_scale_q31(&in[done], gain, 0, prod, len);
+        }
+        else
+        {
+            gain = smooth_ramp(gain, step, ramp, len);
+            arm_mult_q31(&in[done], ramp, prod, len);
+        }
+        arm_add_q31(&acc[done], prod, &acc[done], len);
+    }
+
+    g->cur = g->target;
+}
+
+/**
+ * @brief smooth_delay_init
+ *
+ * @param d
+ * @param line
+ * @param size line length, longer than the delay by SMOOTH_DELAY_CHUNK at least
+ * @param delay samples
+ */
+void smooth_delay_init(struct smooth_delay *d, q31_t *line, uint32_t size, uint32_t delay)
+{
+    memset(line, 0, (size * sizeof(q31_t)));
+
+    d->line = line;
+    d->size = size;
+    d->wr = 0;
+    d->tap = MIN(delay, (size - SMOOTH_DELAY_CHUNK));
+    d->tap_old = d->tap;
+    d->tap_next = d->tap;
+    d->xfade_pos = SMOOTH_XFADE_LEN;
+}
+
+/**
+ * @brief smooth_delay_set; crossfaded in, after the one running if any
+ *
+ * @param d
+ * @param delay samples
+ */
+void smooth_delay_set(struct smooth_delay *d, uint32_t delay)
+{
+    d->tap_next = MIN(delay, (d->size - SMOOTH_DELAY_CHUNK));
+}
+
+/**
+ * @brief smooth_delay_process; out = in delayed
+ *
+ * @param d
+ * @param in
+ * @param out
+ * @param n
+ */
+void smooth_delay_process(struct smooth_delay *d, const q31_t *in, q31_t *out, uint32_t n)
+{
+    q31_t old[SMOOTH_DELAY_CHUNK];
+    q31_t fade_in[SMOOTH_DELAY_CHUNK];
+    q31_t fade_out[SMOOTH_DELAY_CHUNK];
+
+    for (uint32_t done = 0; done < n; done += SMOOTH_DELAY_CHUNK)
+    {
+        uint32_t len = MIN(SMOOTH_DELAY_CHUNK, (n - done));
+        uint32_t pos = d->wr;
+
+        // Next change starts only once the previous fade is over
+        if ((d->xfade_pos >= SMOOTH_XFADE_LEN) && (d->tap_next != d->tap))
+        {
+            d->tap_old = d->tap;
+            d->tap = d->tap_next;
+            d->xfade_pos = 0;
+        }
+
+        // Written first, a delay shorter than the chunk reads this chunk samples
+        smooth_delay_write(d, &in[done], len);
+        smooth_delay_read(d, pos, d->tap, &out[done], len);
+
+        if (d->xfade_pos >= SMOOTH_XFADE_LEN)
+        {
+            continue;
+        }
+
+        uint32_t fade = MIN(len, (SMOOTH_XFADE_LEN - d->xfade_pos));
+        q31_t w = (q31_t)(d->xfade_pos * SMOOTH_XFADE_STEP);
+
+        smooth_delay_read(d, pos, d->tap_old, old, fade);
+        smooth_ramp(w, SMOOTH_XFADE_STEP, fade_in, fade);
+        smooth_ramp((SMOOTH_GAIN_UNITY - w), -SMOOTH_XFADE_STEP, fade_out, fade);
+
+        arm_mult_q31(&out[done], fade_in, &out[done], fade);
+        arm_mult_q31(old, fade_out, old, fade);
+        arm_add_q31(&out[done], old, &out[done], fade);
+        d->xfade_pos += fade;
+    }
+}
+
+/**
+ * @brief smooth_ramp; gain stepped once per sample, first value one step in
+ *
+ * @param gain before the first sample
+ * @param step
+ * @param ramp
+ * @param n
+ * @return q31_t gain of the last sample
+ */
+static q31_t smooth_ramp(q31_t gain, q31_t step, q31_t *ramp, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        gain += step;
+        ramp[i] = gain;
+    }
+
+    return gain;
+}
+
+/**
+ * @brief smooth_delay_write
+ *
+ * @param d
+ * @param in
+ * @param n
+ */
+static void smooth_delay_write(struct smooth_delay *d, const q31_t *in, uint32_t n)
+{
+    uint32_t first = MIN(n, (d->size - d->wr));
+
+    memcpy(&d->line[d->wr], in, (first * sizeof(q31_t)));
+    memcpy(d->line, &in[first], ((n - first) * sizeof(q31_t)));
+    d->wr = ((d->wr + n) % d->size);
+}
+
+/**
+ * @brief smooth_delay_read
+ *
+ * @param d
+ * @param pos line position of the first output sample
+ * @param delay samples
+ * @param out
+ * @param n
+ */
+static void smooth_delay_read(const struct smooth_delay *d, uint32_t pos, uint32_t delay, q31_t *out, uint32_t n)
+{
+    uint32_t rd = ((pos + d->size - delay) % d->size);
+    uint32_t first = MIN(n, (d->size - rd));
+
+    memcpy(out, &d->line[rd], (first * sizeof(q31_t)));
+    memcpy(&out[first], d->line, ((n - first) * sizeof(q31_t)));
+}
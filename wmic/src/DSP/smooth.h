@@ -0,0 +1,47 @@
+/*
+ * smooth.h - Zipper-free gain and delay changes
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: andrea
+ */
+
+#ifndef SMOOTH_H_
+#define SMOOTH_H_
+
+#include <arm_math.h>
+#include <stdint.h>
+
+#define SMOOTH_GAIN_UNITY ((q31_t)0x7FFFFFFF)
+#define SMOOTH_GAIN_CHUNK 64    // Samples per gain ramp pass, bounds the ramp scratch on the stack
+#define SMOOTH_DELAY_CHUNK 64   // Samples per delay pass, bounds the crossfade scratch on the stack
+#define SMOOTH_XFADE_LEN 512    // Crossfade between the old and the new tap (~11.6 ms at 44.1 kHz)
+
+// Gain ramped linearly over the block following a change
+struct smooth_gain
+{
+    q31_t cur;
+    q31_t target;
+};
+
+// Delay line read by two taps during a change, the old one fades out as the new one fades in
+struct smooth_delay
+{
+    q31_t *line;
+    uint32_t size;
+    uint32_t wr;        // Next write position
+    uint32_t tap;       // Delay in samples
+    uint32_t tap_old;   // Delay fading out
+    uint32_t tap_next;  // Delay requested, taken at the end of the running crossfade
+    uint32_t xfade_pos; // Crossfade progress, SMOOTH_XFADE_LEN when idle
+};
+
+void smooth_gain_init(struct smooth_gain *g, q31_t gain);
+void smooth_gain_set(struct smooth_gain *g, q31_t gain);
+void smooth_gain_apply(struct smooth_gain *g, const q31_t *in, q31_t *out, uint32_t n);
+void smooth_gain_mac(struct smooth_gain *g, const q31_t *in, q31_t *acc, uint32_t n);
+
+void smooth_delay_init(struct smooth_delay *d, q31_t *line, uint32_t size, uint32_t delay);
+void smooth_delay_set(struct smooth_delay *d, uint32_t delay);
+void smooth_delay_process(struct smooth_delay *d, const q31_t *in, q31_t *out, uint32_t n);
+
+#endif /* SMOOTH_H_ */
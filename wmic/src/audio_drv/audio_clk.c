@@ -0,0 +1,147 @@
+/*
+ * Audio clock management
+ * I2S/HFCLKAUDIO: nRF5340
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ *
+ * The RATIO/MCK settings are searched at run time for the requested frame
+ * clock. HFCLKAUDIO is set once: the BT module is I2S slave of our clocks,
+ * so no module paced reference exists to trim it against.
+ */
+
+#include "audio_clk.h"
+
+/* System */
+#include <zephyr/kernel.h>
+#include <hal/nrf_clock.h>
+/* Standard C libraries */
+#include <stdlib.h>
+
+// Clock sources
+#define AUDIO_CLK_PCLK_FREQ 32000000ULL // PCLK32M
+#define AUDIO_CLK_PCLK_MCK_MAX 16000000 // Max MCK obtainable through the MCKFREQ divider
+#define AUDIO_CLK_ACLK_VAL_MAX 65535
+#define AUDIO_CLK_ACLK_VAL_OFFSET (4ULL * 65536) // HFCLKAUDIO = 32MHz * (4 + FREQ_VALUE / 2^16) / 12
+
+// CLKCONFIG register values
+#define AUDIO_CLK_CLKCONFIG_PCLK 0x0000
+#define AUDIO_CLK_CLKCONFIG_ACLK_BYPASS 0x0101 // Bypass internal MCK scaler (directly take the ACLK source)
+
+static const uint16_t audio_clk_ratios[] = {32, 48, 64, 96, 128, 192, 256, 384, 512}; // Index = RATIO register value
+
+static int32_t audio_clk_err_ppm(uint64_t actual_mhz, uint64_t req_mhz);
+
+/**
+ * @brief audio_clk_compute; search the RATIO/MCK settings closest to the requested frame clock
+ *
+ *  NOTE; port of scripts/octave/I2S/I2S_calc.m and I2S_find_fs.m
+ *
+ * @param fs
+ * @param word_bits
+ * @param cfg
+ * @return int
+ */
+int audio_clk_compute(uint32_t fs, uint8_t word_bits, struct audio_clk_cfg *cfg)
+{
+    int32_t best_err = INT32_MAX;
+
+    for (uint8_t r = 0; r < ARRAY_SIZE(audio_clk_ratios); r++)
+    {
+        uint16_t ratio = audio_clk_ratios[r];
+        uint64_t mck_req = ((uint64_t)fs * ratio);
+
+        // SCK = 2 * word size * fs must be derivable from MCK
+        if (ratio < (2 * word_bits))
+        {
+            continue;
+        }
+
+        // ACLK with MCK scaler bypassed, HFCLKAUDIO tuned to ratio * fs
+        int64_t val = (int64_t)(((mck_req * 12 * 65536) + (AUDIO_CLK_PCLK_FREQ / 2)) / AUDIO_CLK_PCLK_FREQ) - (int64_t)AUDIO_CLK_ACLK_VAL_OFFSET;
+        if ((val >= 0) && (val <= AUDIO_CLK_ACLK_VAL_MAX))
+        {
+            // Frequencies in mHz to keep the fractional part
+            uint64_t aclk_mhz = ((AUDIO_CLK_PCLK_FREQ * 1000 * (AUDIO_CLK_ACLK_VAL_OFFSET + (uint64_t)val)) / (12 * 65536));
+            int32_t err = audio_clk_err_ppm(aclk_mhz, (mck_req * 1000));
+
+            if (abs(err) < abs(best_err))
+            {
+                best_err = err;
+                cfg->src = AUDIO_CLK_SRC_ACLK;
+                cfg->ratio = r;
+                cfg->ratio_val = ratio;
+                cfg->mck_freq = 0;
+                cfg->aclk_freq_value = (uint16_t)val;
+                cfg->err_ppm = err;
+            }
+        }
+
+        // PCLK32M through the MCKFREQ divider
+        if ((mck_req > 0) && (mck_req <= AUDIO_CLK_PCLK_MCK_MAX))
+        {
+            uint64_t mck_calc = 4096 * ((mck_req * 1048576) / (AUDIO_CLK_PCLK_FREQ + (mck_req / 2)));
+            if (mck_calc == 0)
+            {
+                continue;
+            }
+            uint64_t div = ((1048576ULL * 4096) / mck_calc);
+            uint64_t mck_mhz = ((AUDIO_CLK_PCLK_FREQ * 1000) / div);
+            int32_t err = audio_clk_err_ppm(mck_mhz, (mck_req * 1000));
+
+            if (abs(err) < abs(best_err))
+            {
+                best_err = err;
+                cfg->src = AUDIO_CLK_SRC_PCLK32M;
+                cfg->ratio = r;
+                cfg->ratio_val = ratio;
+                cfg->mck_freq = (uint32_t)mck_calc;
+                cfg->aclk_freq_value = 0;
+                cfg->err_ppm = err;
+            }
+        }
+    }
+
+    if (best_err == INT32_MAX)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief audio_clk_apply
+ *
+ *  NOTE; these settings are not possible with Zephyr APIs and
+ *        must be set after the I2S trigger to have effect.
+ *
+ * @param cfg
+ */
+void audio_clk_apply(const struct audio_clk_cfg *cfg)
+{
+    if (cfg->src == AUDIO_CLK_SRC_ACLK)
+    {
+        nrf_clock_hfclkaudio_config_set(NRF_CLOCK, cfg->aclk_freq_value);
+        NRF_I2S0->CONFIG.RATIO = cfg->ratio;
+        NRF_I2S0->CONFIG.CLKCONFIG = AUDIO_CLK_CLKCONFIG_ACLK_BYPASS;
+    }
+    else
+    {
+        NRF_I2S0->CONFIG.MCKFREQ = cfg->mck_freq;
+        NRF_I2S0->CONFIG.RATIO = cfg->ratio;
+        NRF_I2S0->CONFIG.CLKCONFIG = AUDIO_CLK_CLKCONFIG_PCLK;
+    }
+}
+
+/**
+ * @brief audio_clk_err_ppm
+ *
+ * @param actual_mhz
+ * @param req_mhz
+ * @return int32_t
+ */
+static int32_t audio_clk_err_ppm(uint64_t actual_mhz, uint64_t req_mhz)
+{
+    return (int32_t)((((int64_t)actual_mhz - (int64_t)req_mhz) * 1000000) / (int64_t)req_mhz);
+}
@@ -0,0 +1,25 @@
+#ifndef AUDIO_CLK_H
+#define AUDIO_CLK_H
+
+#include <stdint.h>
+
+enum audio_clk_src_e
+{
+    AUDIO_CLK_SRC_PCLK32M = 0,
+    AUDIO_CLK_SRC_ACLK,
+};
+
+struct audio_clk_cfg
+{
+    enum audio_clk_src_e src;
+    uint8_t ratio;            // I2S CONFIG.RATIO register value
+    uint16_t ratio_val;       // MCK / LRCK ratio
+    uint32_t mck_freq;        // I2S CONFIG.MCKFREQ register value (PCLK32M only)
+    uint16_t aclk_freq_value; // HFCLKAUDIO FREQUENCY register value (ACLK only)
+    int32_t err_ppm;          // Frame clock error of the computed settings
+};
+
+int audio_clk_compute(uint32_t fs, uint8_t word_bits, struct audio_clk_cfg *cfg);
+void audio_clk_apply(const struct audio_clk_cfg *cfg);
+
+#endif /* AUDIO_CLK_H */
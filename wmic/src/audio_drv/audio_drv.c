@@ -7,6 +7,7 @@
  */
 
 #include "audio_drv.h"
+#include "audio_clk.h"
 
 /* System */
 #include <zephyr/device.h>
@@ -17,14 +18,10 @@
 #include <zephyr/sys/reboot.h>
 
 // I2S defines
-#define CHANNELS_NUMBER 2
-#define SAMPLE_FREQ 44100 // bt module requires 44.1kHz or 48kHz
 #define I2S_WORD_BYTES 4  // 32 bits word
 #define I2S_RX_DELAY 2000 // After this time, i2s_read and i2s_write gives an error
 
 // Buffer defines
-#define BUFFER_BLOCK_TIME_MS 10 // Stored audio track lenght in ms
-#define DATA_BUFFER_SIZE ((SAMPLE_FREQ * BUFFER_BLOCK_TIME_MS) / 1000)
 #define INITIAL_BLOCKS 2   // Needed by Zephyr I2S driver (>= 2)
 #define AVAILABLE_BLOCKS 3 // Further blocks available in case of necessity
 #define NUM_BLOCKS (INITIAL_BLOCKS + AVAILABLE_BLOCKS)
@@ -41,6 +38,7 @@ struct audio_drv_handler_t
 {
     const struct device *dev_i2s;
     struct i2s_config i2s_cfg;
+    struct audio_clk_cfg clk_cfg;
     uint8_t i2s_cfg_dir;
     pi2s_elab i2s_elab;
 } static audio_drv_handler;
@@ -82,16 +80,37 @@ int audio_drv_config(const struct device *i2s_dev, pi2s_elab cb)
         return -1;
     }
 
+    // Compute the RATIO/MCK settings for the requested frame clock
+    if (audio_clk_compute(SAMPLE_FREQ, (I2S_WORD_BYTES * 8), &audio_drv_handler.clk_cfg) < 0)
+    {
+        printf("Failed to compute I2S clock settings\n");
+        return -1;
+    }
+    printk("I2S clock: ratio x%u, error %d ppm\n", audio_drv_handler.clk_cfg.ratio_val, audio_drv_handler.clk_cfg.err_ppm);
+
     k_thread_create(&audio_drv_txrx_tcb,
                     audio_drv_txrx_stack,
                     AUDIO_DRV_TXRX_THREAD_STACK,
                     audio_drv_txrx_thread,
                     NULL, NULL, NULL,
-                    AUDIO_DRV_TXRX_THREAD_PRIORITY, 0, K_MSEC(500));
+                    AUDIO_DRV_TXRX_THREAD_PRIORITY, 0, K_NO_WAIT);
 
     return 0;
 }
 
+/**
+ * @brief audio_drv_io_frames; frames a sample spends in the I2S queues, RX block being filled and TX blocks queued ahead
+ *
+ *  NOTE; the block processing runs while the TX queue drains, it adds
+ *        nothing as long as it fits in a block time
+ *
+ * @return uint32_t
+ */
+uint32_t audio_drv_io_frames(void)
+{
+    return ((1 + INITIAL_BLOCKS) * DATA_BUFFER_SIZE);
+}
+
 /**
  * @brief audio_drv_txrx_thread
  *
@@ -106,16 +125,8 @@ static void audio_drv_txrx_thread(void *a, void *b, void *c)
     // Trigger start
     audio_drv_i2s_trigger_txrx();
 
-    /* Bare metal settings
-     *
-     *  NOTE1; these settings are not possible with
-     *        Zephyr APIs.
-     *
-     *  NOTE2; these settings must be set after i2s_trigger_txrx() to have effect.
-     */
-    // NRF_I2S0->CONFIG.MCKFREQ = 0x81F30000; // Calculated via script octave
-    NRF_I2S0->CONFIG.RATIO = 6;            // x256
-    NRF_I2S0->CONFIG.CLKCONFIG = (0x0101); // Bypass internal MCK scaler (directly take the ACLK source)
+    // Clock settings must be set after i2s_trigger_txrx() to have effect
+    audio_clk_apply(&audio_drv_handler.clk_cfg);
 
     while (1)
     {
@@ -132,8 +143,7 @@ static void audio_drv_txrx_thread(void *a, void *b, void *c)
                 sys_reboot(SYS_REBOOT_COLD);
             }
 
-            NRF_I2S0->CONFIG.RATIO = 6;
-            NRF_I2S0->CONFIG.CLKCONFIG = (0x0101);
+            audio_clk_apply(&audio_drv_handler.clk_cfg);
         }
     }
 }
@@ -7,8 +7,17 @@
 #include <math.h>
 #include <limits.h>
 
+// I2S defines
+#define CHANNELS_NUMBER 2
+#define SAMPLE_FREQ 44100 // bt module requires 44.1kHz or 48kHz
+
+// Buffer defines
+#define BUFFER_BLOCK_TIME_MS 10 // Stored audio track lenght in ms
+#define DATA_BUFFER_SIZE ((SAMPLE_FREQ * BUFFER_BLOCK_TIME_MS) / 1000)
+
 typedef void (*pi2s_elab)(int32_t *pmem, uint32_t block_size); // Callback function for data elaboration
 
 int audio_drv_config(const struct device *i2s_dev, pi2s_elab cb);
+uint32_t audio_drv_io_frames(void);
 
 #endif /* AUDIO_DRV_H */
\ No newline at end of file
@@ -7,26 +7,110 @@
  */
 
 #include "bluetooth_drv.h"
+#include "bluetooth_line.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/uart.h>
 #include <zephyr/sys/printk.h>
+#include <zephyr/settings/settings.h>
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
-
-#define RX_BUFF_SIZE 500
-#define BLUETOOTH_DRV_MAX_PEERS 10
+#include <stdio.h>
+
+#define RX_DMA_BUFF_SIZE 64
+#define RX_BUFF_SIZE (8 * RX_DMA_BUFF_SIZE) // The DMA fills the ring directly, one chunk after the other
+#define RX_IDLE_TIMEOUT_US 1000 // Idle line time after which the received bytes are reported
+#define TX_CMD_SIZE 100
+#define TX_QUEUE_LEN 8
+
+// AT transactions timeouts
+#define AT_TIMEOUT_MS 300       // Settings, answered with OK
+#define AT_BOOT_TIMEOUT_MS 3000 // Module restart, answered with the +NAME banner
+#define AT_CONN_TIMEOUT_MS 5000 // A2DP link status change
+#define AT_RETRIES 2
+#define BLUETOOTH_DRV_MRU_SIZE 3 // Last connected peers, tried before scanning
+#define BLUETOOTH_DRV_PEER_STALE_MS 30000 // Peers not advertised for this long are dropped
 
 #define BLUETOOTH_DRV_DECODE_THREAD_STACK (1024)
 #define BLUETOOTH_DRV_DECODE_THREAD_PRIORITY 7
+#define BLUETOOTH_DRV_LINK_THREAD_STACK (3072) // AT transactions and the NVS write of the peers cache
+#define BLUETOOTH_DRV_LINK_THREAD_PRIORITY 8
+#define BLUETOOTH_DRV_LINK_QUEUE_LEN 4
+#define BLUETOOTH_DRV_LINK_POLL_MS 2000 // Link status and RSSI query period while connected
+#define BLUETOOTH_DRV_EVT_THREAD_STACK (1024)
+#define BLUETOOTH_DRV_EVT_THREAD_PRIORITY 9
+#define BLUETOOTH_DRV_EVT_QUEUE_LEN 8
+#define BLUETOOTH_DRV_SUBSCRIBERS_MAX 4
 
 K_THREAD_STACK_DEFINE(bluetooth_drv_decode_stack, BLUETOOTH_DRV_DECODE_THREAD_STACK);
+K_THREAD_STACK_DEFINE(bluetooth_drv_link_stack, BLUETOOTH_DRV_LINK_THREAD_STACK);
+K_THREAD_STACK_DEFINE(bluetooth_drv_evt_stack, BLUETOOTH_DRV_EVT_THREAD_STACK);
 K_SEM_DEFINE(bluetooth_drv_uart_sem, 0, 1);
 
+// +A2DPSTAT values, from the AT+A2DPSTAT description of the Feasycom AT command manual
+// (the FSC-BT1036x datasheet in res/ doesn't list the AT commands)
+enum bluetooth_drv_a2dp_e
+{
+    BT_A2DP_UNSUPPORTED = 0,
+    BT_A2DP_STANDBY,    // Idle, link lost included
+    BT_A2DP_CONNECTING, // Reported while A2DPCONN is in progress
+    BT_A2DP_CONNECTED,  // Link established
+    BT_A2DP_STREAMING,  // Link established, audio routed
+};
+
+// AT commands waiting for the UART TX DMA
+struct bluetooth_drv_tx_cmd
+{
+    char str[TX_CMD_SIZE];
+};
+K_MSGQ_DEFINE(bluetooth_drv_tx_msgq, sizeof(struct bluetooth_drv_tx_cmd), TX_QUEUE_LEN, 4);
+
+// A2DP link requests, served by the link thread
+enum bluetooth_drv_req_e
+{
+    BT_REQ_RECONNECT = 0, // Try the cached peers, scan if none answers
+    BT_REQ_CONNECT,       // Connect to the given peer
+    BT_REQ_SCAN,          // Refresh the advertised peers
+};
+// Peer address, the string is kept as the module reported it
+struct bluetooth_drv_addr
+{
+    uint8_t mac[BLUETOOTH_DRV_MAC_LEN];
+    char str[BLUETOOTH_DRV_ADDR_SIZE];
+};
+struct bluetooth_drv_req
+{
+    enum bluetooth_drv_req_e type;
+    struct bluetooth_drv_addr addr;
+};
+K_MSGQ_DEFINE(bluetooth_drv_link_msgq, sizeof(struct bluetooth_drv_req), BLUETOOTH_DRV_LINK_QUEUE_LEN, 4);
+
+// Link events, published without waiting and dispatched to the subscribers by the event thread
+K_MSGQ_DEFINE(bluetooth_drv_evt_msgq, sizeof(struct bluetooth_drv_link_evt), BLUETOOTH_DRV_EVT_QUEUE_LEN, 4);
+
+// AT transaction in progress, completed by the decode thread
+K_MUTEX_DEFINE(bluetooth_drv_at_mutex);
+K_MUTEX_DEFINE(bluetooth_drv_peers_mutex);
+K_MUTEX_DEFINE(bluetooth_drv_link_mutex); // Link stats, written by the decode, link and publisher threads
+K_SEM_DEFINE(bluetooth_drv_at_sem, 0, 1);
+K_SEM_DEFINE(bluetooth_drv_a2dpstat_sem, 0, 1); // Given by the decoder on every +A2DPSTAT
+struct bluetooth_drv_at_t
+{
+    const char *expect; // +KEY needed by the transaction, NULL if none
+    bool key_seen;
+    bool final_seen; // OK of the command, preset when no command is sent
+    int result;
+    atomic_t active;
+} static bluetooth_drv_at;
+
+// OK/ERROR still owed by the module, one per command sent. A final line
+// belongs to the running command only when it is the last one owed.
+static atomic_t bluetooth_drv_at_pending = ATOMIC_INIT(0);
+
 // BT data structures
 struct bluetooth_drv_status_t
 {
@@ -43,46 +127,143 @@ struct bluetooth_drv_status_t
     int ok;
     char name[30];
     int i2scfg;
+    int autoconn;
+    int rssi;
+};
+
+// Module setting stored in its flash, checked at every boot
+struct bluetooth_drv_setting
+{
+    const char *key;    // Command name, used as query too
+    const char *expect; // Query answer
+    int *field;         // Status field filled by the answer
+    int value;
 };
 struct bluetooth_drv_handler_t
 {
     const struct device *uart_int;
     struct bluetooth_drv_status_t bluetooth_drv_status;
-    struct bluetooth_peers peer[BLUETOOTH_DRV_MAX_PEERS];
+    struct bluetooth_peers peer[BLUETOOTH_DRV_MAX_PEERS]; // Sorted by RSSI, strongest first
     uint16_t peer_num;
+    struct bluetooth_drv_addr mru[BLUETOOTH_DRV_MRU_SIZE]; // Most recent first, persisted in the "bt/mru" setting
+    bt1036c_evt_cb cb;
+    int64_t start_ms; // Uptime at bluetooth_drv_config
+    int64_t boot_ms;  // Time spent in bluetooth_drv_config
+    bluetooth_drv_link_cb subscriber[BLUETOOTH_DRV_SUBSCRIBERS_MAX];
+    uint8_t subscriber_num;
+    struct bluetooth_drv_link_stats link;
+    uint32_t down_since_ms; // Uptime of the last link loss
+    bool link_lost;         // Link lost at least once, next link up is a reconnection
 } static bluetooth_drv_handler = {0};
 
 static struct k_thread bluetooth_drv_decode_tcb;
+static struct k_thread bluetooth_drv_link_tcb;
+static struct k_thread bluetooth_drv_evt_tcb;
 
-static uint8_t irq_buf[128]; // Temporary buffer used to read from FIFO in IRQ context
 static uint8_t cmd_buff_rx[RX_BUFF_SIZE];
-static uint16_t rx_buff_idx = 0;
+static uint16_t rx_dma_next = 0;           // Ring offset of the next chunk handed to the DMA
+static volatile uint16_t rx_buff_idx = 0;  // Write index, bytes reported by the DMA
+static volatile uint16_t rx_decode_idx = 0; // Read index, owned by the decode thread
+static atomic_t rx_resync = ATOMIC_INIT(0); // Unread data overwritten, the decoder restarts from the write index
+static uint32_t rx_overruns = 0;
+static struct bluetooth_drv_tx_cmd tx_cmd; // Command under DMA transfer
+static atomic_t tx_busy = ATOMIC_INIT(0);
 
 static void bluetooth_drv_decode_thread(void *a, void *b, void *c);
+static void bluetooth_drv_link_thread(void *a, void *b, void *c);
+static void bluetooth_drv_link_up(void);
+static void bluetooth_drv_link_poll(void);
+static void bluetooth_drv_evt_thread(void *a, void *b, void *c);
+static void bluetooth_drv_evt_publish(const struct bluetooth_drv_link_evt *evt);
+
+static void bluetooth_drv_uart_cb(const struct device *dev, struct uart_event *evt, void *user_data);
+static int bluetooth_drv_rx_enable(void);
+static void bluetooth_drv_rx_done(const uint8_t *data, size_t len);
+
+static void bluetooth_drv_tx_next(void);
+static int bluetooth_drv_decode_data(const struct bluetooth_line *line);
+static void bluetooth_drv_at_complete(const struct bluetooth_line *line, uint16_t key_len);
+static void bluetooth_drv_at_drain(void);
+
+static void bluetooth_drv_on_int(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size);
+static void bluetooth_drv_on_str(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size);
+static void bluetooth_drv_on_scan(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size);
+static void bluetooth_drv_on_rssi(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size);
+static void bluetooth_drv_on_a2dpstat(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size);
+
+static int bluetooth_drv_reconcile(const struct bluetooth_drv_setting *settings, uint8_t settings_n);
+static int bluetooth_drv_a2dp_connect(const struct bluetooth_drv_addr *addr);
+static int bluetooth_drv_mru_connect(void);
+static void bluetooth_drv_mru_push(const struct bluetooth_drv_addr *addr);
+static void bluetooth_drv_peers_update(const struct bluetooth_peers *peer);
+static int bluetooth_drv_mac_parse(const char *str, uint8_t *mac);
+static int bluetooth_drv_settings_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg);
+
+SETTINGS_STATIC_HANDLER_DEFINE(bluetooth_drv, "bt", NULL, bluetooth_drv_settings_set, NULL, NULL);
+
+// Sorted by key, looked up with bsearch
+static const struct bluetooth_line_key bluetooth_drv_keys[] = {
+    {"+A2DPSTAT", bluetooth_drv_on_a2dpstat, &bluetooth_drv_handler.bluetooth_drv_status.a2dpstat, 0},
+    {"+AUTOCONN", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.autoconn, 0},
+    {"+AVRCPSTAT", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.avrcpstat, 0},
+    {"+DEVSTAT", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.devstat, 0},
+    {"+GATTSTAT", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.gattstat, 0},
+    {"+HFPSTAT", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.hfpstat, 0},
+    {"+I2SCFG", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.i2scfg, 0},
+    {"+NAME", bluetooth_drv_on_str, bluetooth_drv_handler.bluetooth_drv_status.name, sizeof(bluetooth_drv_handler.bluetooth_drv_status.name)},
+    {"+PBSTAT", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.pbstat, 0},
+    {"+PROFILE", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.profile, 0},
+    {"+PWRSTAT", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.pwrstat, 0},
+    {"+RSSI", bluetooth_drv_on_rssi, &bluetooth_drv_handler.bluetooth_drv_status.rssi, 0},
+    {"+SCAN", bluetooth_drv_on_scan, NULL, 0},
+    {"+SPPSTAT", bluetooth_drv_on_int, &bluetooth_drv_handler.bluetooth_drv_status.sppstat, 0},
+    {"+VER", bluetooth_drv_on_str, bluetooth_drv_handler.bluetooth_drv_status.ver, sizeof(bluetooth_drv_handler.bluetooth_drv_status.ver)},
+};
 
-static void bluetooth_drv_uart_irq_cb(const struct device *dev, void *user_data);
+// SINK (riceve audio via Bluetooth)
+static const struct bluetooth_drv_setting bluetooth_drv_rx_settings[] = {
+    {"PROFILE", "+PROFILE", &bluetooth_drv_handler.bluetooth_drv_status.profile, 32}, // A2DP Sink
+};
 
-static void uart_write_str(const char *s);
-static int bluetooth_drv_decode_data(char *s);
-static void extract_name(const char *input, struct bluetooth_peers *peer);
-static void extract_mac(const char *input, struct bluetooth_peers *peer);
+// SOURCE (sends the I2S audio via Bluetooth)
+static const struct bluetooth_drv_setting bluetooth_drv_tx_settings[] = {
+    {"PROFILE", "+PROFILE", &bluetooth_drv_handler.bluetooth_drv_status.profile, 64},    // A2DP Source
+    {"I2SCFG", "+I2SCFG", &bluetooth_drv_handler.bluetooth_drv_status.i2scfg, 71},       // I2S slave, 44.1kHz, 32 bit data size
+    {"AUTOCONN", "+AUTOCONN", &bluetooth_drv_handler.bluetooth_drv_status.autoconn, 64}, // Reconnect in case of connection lost
+};
 
 /**
- * @brief bluetooth_drv_config
+ * @brief bluetooth_drv_config; the settings subsystem must be initialized by the application
  * 
  * @param uart 
  * @param cb 
  * @param txrx_config 
  * @return int 
  */
-int bluetooth_drv_config(const struct device *uart, bt1036c_peers_cb cb, const uint8_t txrx_config)
+int bluetooth_drv_config(const struct device *uart, bt1036c_evt_cb cb, const uint8_t txrx_config)
 {
-    char str_mac[100];
-
     bluetooth_drv_handler.uart_int = uart;
+    bluetooth_drv_handler.cb = cb;
+
+    // Restore the last connected peers
+    if (settings_load_subtree("bt") != 0)
+    {
+        printk("BT peers cache not available\n");
+    }
 
-    uart_irq_callback_user_data_set(uart, bluetooth_drv_uart_irq_cb, NULL);
-    uart_irq_rx_enable(uart);
+    if ((uart_callback_set(uart, bluetooth_drv_uart_cb, NULL) != 0) || (bluetooth_drv_rx_enable() != 0))
+    {
+        printk("BT UART async RX not available\n");
+        return -1;
+    }
+
+    k_thread_create(&bluetooth_drv_evt_tcb,
+                    bluetooth_drv_evt_stack,
+                    BLUETOOTH_DRV_EVT_THREAD_STACK,
+                    bluetooth_drv_evt_thread,
+                    NULL, NULL, NULL,
+                    BLUETOOTH_DRV_EVT_THREAD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&bluetooth_drv_evt_tcb, "bt_evt");
 
     k_thread_create(&bluetooth_drv_decode_tcb,
                     bluetooth_drv_decode_stack,
@@ -90,418 +271,1047 @@ int bluetooth_drv_config(const struct device *uart, bt1036c_peers_cb cb, const u
                     bluetooth_drv_decode_thread,
                     NULL, NULL, NULL,
                     BLUETOOTH_DRV_DECODE_THREAD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&bluetooth_drv_decode_tcb, "bt_decode");
 
-    // Reset the module to default settings
-    bluetooth_drv_at_send("RESTORE");
-    k_sleep(K_MSEC(1000));
+    bluetooth_drv_handler.start_ms = k_uptime_get();
+    bluetooth_drv_handler.down_since_ms = (uint32_t)bluetooth_drv_handler.start_ms;
 
-    /*
-     * NOTE; here we are still in the main thread,
-     *       we need to add a small sleep delay
-     *       after each send to allow the bt thread
-     *       to execute and decode the received data
-     */
+    // Check the module is answering
+    if (bluetooth_drv_at_transact("NAME", "+NAME", K_MSEC(AT_TIMEOUT_MS), AT_RETRIES) != 0)
+    {
+        printk("BT module not found on UART\n");
+        return -1;
+    }
 
     if (txrx_config == BT103036C_CONFIG_RX)
     {
-        // SINK (riceve audio via Bluetooth)
-        bluetooth_drv_at_send("PROFILE=32"); // A2DP Sink
-        k_sleep(K_MSEC(50));
-
-        bluetooth_drv_at_send("PAIR=1"); // Discoverable
-        k_sleep(K_MSEC(50));
+        if ((bluetooth_drv_reconcile(bluetooth_drv_rx_settings, ARRAY_SIZE(bluetooth_drv_rx_settings)) != 0) ||
+            (bluetooth_drv_at_transact("PAIR=1", NULL, K_MSEC(AT_TIMEOUT_MS), AT_RETRIES) != 0)) // Discoverable
+        {
+            printk("BT module configuration failed\n");
+            return -1;
+        }
     }
     else // txrx_config == BT103036C_CONFIG_TX
     {
-        bluetooth_drv_at_send("PROFILE=64"); // A2DP Source
-        k_sleep(K_MSEC(50));
-
-        bluetooth_drv_at_send("I2SCFG=71"); // I2S slave, 44.1kHz, 32 bit data size
-        k_sleep(K_MSEC(50));
-
-        bluetooth_drv_at_send("AUTOCONN=64"); // Reconnect in case of connection lost
-        k_sleep(K_MSEC(50));
+        if (bluetooth_drv_reconcile(bluetooth_drv_tx_settings, ARRAY_SIZE(bluetooth_drv_tx_settings)) != 0)
+        {
+            printk("BT module configuration failed\n");
+            return -1;
+        }
     }
 
-    k_sleep(K_MSEC(500));
-
-    bluetooth_drv_at_send("REBOOT"); // Reboot to make changes effective
-    k_sleep(K_MSEC(1000));
+    bluetooth_drv_handler.boot_ms = (k_uptime_get() - bluetooth_drv_handler.start_ms);
+    printk("BT module ready in %d ms\n", (int)bluetooth_drv_handler.boot_ms);
 
-    if (bluetooth_drv_handler.bluetooth_drv_status.name[0] == '\0')
+    if (txrx_config != BT103036C_CONFIG_RX)
     {
-        printk("BT module not found on UART\n");
-        return -1;
+        // The A2DP link is set up in background, the caller goes on with the audio init
+        k_thread_create(&bluetooth_drv_link_tcb,
+                        bluetooth_drv_link_stack,
+                        BLUETOOTH_DRV_LINK_THREAD_STACK,
+                        bluetooth_drv_link_thread,
+                        NULL, NULL, NULL,
+                        BLUETOOTH_DRV_LINK_THREAD_PRIORITY, 0, K_NO_WAIT);
+        k_thread_name_set(&bluetooth_drv_link_tcb, "bt_link");
+
+        struct bluetooth_drv_req req = {.type = BT_REQ_RECONNECT};
+        k_msgq_put(&bluetooth_drv_link_msgq, &req, K_NO_WAIT);
     }
 
-    if (txrx_config != BT103036C_CONFIG_RX)
-    {
-        bluetooth_drv_at_send("SCAN=1"); // Scan advertised MAC addresses
-        k_sleep(K_MSEC(1000));
+    return 0;
+}
 
-        // Call calback for peer selction
-        uint16_t peer_idx = cb(bluetooth_drv_handler.peer, &bluetooth_drv_handler.peer_num);
+/**
+ * @brief bluetooth_drv_connect; request the A2DP link to the peer, BT_EVT_CONNECTED or BT_EVT_CONN_FAILED follows
+ *
+ * @param peer as given by bluetooth_drv_peers_snapshot
+ * @return int
+ */
+int bluetooth_drv_connect(const struct bluetooth_peers *peer)
+{
+    struct bluetooth_drv_req req = {.type = BT_REQ_CONNECT};
 
-        // Set selected MAC address
-        snprintf(str_mac, sizeof(str_mac), "A2DPCONN=%s", (const char *)bluetooth_drv_handler.peer[peer_idx].mac);
-        bluetooth_drv_at_send(str_mac); // Hardwired MAC address
-        k_sleep(K_MSEC(2000));
+    memcpy(req.addr.mac, peer->mac, BLUETOOTH_DRV_MAC_LEN);
+    strncpy(req.addr.str, peer->addr, (sizeof(req.addr.str) - 1));
+    return k_msgq_put(&bluetooth_drv_link_msgq, &req, K_NO_WAIT);
+}
 
-        bluetooth_drv_at_send("AUDROUTE=1"); // Start A2DP communication of I2S data received
-        k_sleep(K_MSEC(100));
+/**
+ * @brief bluetooth_drv_link_subscribe; register a link events callback, before bluetooth_drv_config
+ *
+ * @param cb
+ * @return int
+ */
+int bluetooth_drv_link_subscribe(bluetooth_drv_link_cb cb)
+{
+    if (bluetooth_drv_handler.subscriber_num >= BLUETOOTH_DRV_SUBSCRIBERS_MAX)
+    {
+        return -1;
     }
 
+    bluetooth_drv_handler.subscriber[bluetooth_drv_handler.subscriber_num++] = cb;
     return 0;
 }
 
 /**
- * @brief bluetooth_drv_at_send
+ * @brief bluetooth_drv_link_get_stats
  *
- * @param cmd
+ * @param stats
  */
-void bluetooth_drv_at_send(const char *cmd)
+void bluetooth_drv_link_get_stats(struct bluetooth_drv_link_stats *stats)
 {
-    char buffer[100];
-    strcpy(buffer, "AT+");
-    strncat(buffer, cmd, sizeof(buffer) - strlen(buffer) - 1);
-    strncat(buffer, "\r\n", sizeof(buffer) - strlen(buffer) - 1);
-    uart_write_str(buffer);
+    k_mutex_lock(&bluetooth_drv_link_mutex, K_FOREVER);
+    *stats = bluetooth_drv_handler.link;
+    k_mutex_unlock(&bluetooth_drv_link_mutex);
 }
 
 /**
- * @brief bluetooth_drv_decode_thread
+ * @brief bluetooth_drv_scan; request a new scan of the advertised peers
+ *
+ * @return int
+ */
+int bluetooth_drv_scan(void)
+{
+    struct bluetooth_drv_req req = {.type = BT_REQ_SCAN};
+
+    return k_msgq_put(&bluetooth_drv_link_msgq, &req, K_NO_WAIT);
+}
+
+/**
+ * @brief bluetooth_drv_link_thread
  *
  * @param a
  * @param b
  * @param c
  */
-static void bluetooth_drv_decode_thread(void *a, void *b, void *c)
+static void bluetooth_drv_link_thread(void *a, void *b, void *c)
 {
-    static uint16_t decode_idx = 0;
-    char payload[100];
+    struct bluetooth_drv_req req;
 
     while (1)
     {
-        // Wait for UART received data interrupt
-        k_sem_take(&bluetooth_drv_uart_sem, K_FOREVER);
-
-        // Avoid UART interrupt when here
-        uart_irq_rx_disable(bluetooth_drv_handler.uart_int);
-
-        // Consider the distance between the two indexes
-        // NOTE; summing RX_BUFF_SIZE is necessary to consider also the case in which
-        //       rx_buff_idx is one turn haed compared to decode_idx
-        uint16_t dist = (rx_buff_idx + RX_BUFF_SIZE - decode_idx) % RX_BUFF_SIZE;
-        if (dist > 2) // Condition needed because each packet starts with \r\n
+        // No request within the poll period, check the established link
+        if (k_msgq_get(&bluetooth_drv_link_msgq, &req, K_MSEC(BLUETOOTH_DRV_LINK_POLL_MS)) != 0)
         {
-            uint16_t next = ((decode_idx + 1) % RX_BUFF_SIZE);
+            bluetooth_drv_link_poll();
+            continue;
+        }
 
-            if ((cmd_buff_rx[decode_idx] == '\r') &&
-                (cmd_buff_rx[next] == '\n'))
+        switch (req.type)
+        {
+        case BT_REQ_RECONNECT:
+            // Reconnect to a known peer first, scan only if none answers
+            if (bluetooth_drv_mru_connect() == 0)
+            {
+                bluetooth_drv_link_up();
+            }
+            else
+            {
+                // Scan advertised MAC addresses, peers keep being added during the selection
+                bluetooth_drv_at_transact("SCAN=1", NULL, K_MSEC(AT_TIMEOUT_MS), AT_RETRIES);
+                bluetooth_drv_handler.cb(BT_EVT_SCANNING);
+            }
+            break;
+        case BT_REQ_CONNECT:
+            if (bluetooth_drv_a2dp_connect(&req.addr) == 0)
             {
-                uint16_t i = (decode_idx + 2) % RX_BUFF_SIZE; // Start of the packet received
-                uint16_t payload_idx = 0;                     // Payload index
-
-                // Read until the end of the circular buffer is reached
-                while (i != rx_buff_idx)
-                {
-                    char c = cmd_buff_rx[i];
-
-                    if (c == '\n')
-                    {
-                        // End sequence \n found
-                        payload[payload_idx] = '\0';
-                        bluetooth_drv_decode_data(payload);
-                        // Only now we can increase the decoding index (in this way we start previous index until the end sequence is reached)
-                        decode_idx = (i + 1) % RX_BUFF_SIZE;
-                        break;
-                    }
-
-                    if ((c != '\r') && (payload_idx < sizeof(payload) - 1))
-                    {
-                        payload[payload_idx] = c;
-                        payload_idx++;
-                    }
-
-                    i = ((i + 1) % RX_BUFF_SIZE);
-                }
+                bluetooth_drv_mru_push(&req.addr);
+                bluetooth_drv_link_up();
             }
-            else // No \r\n sequence, data corrupted
+            else
             {
-                // Search for \r\n sequence in the remaining buffer
-                while ((cmd_buff_rx[decode_idx] != '\r') || (cmd_buff_rx[next] != '\n'))
-                {
-                    if (next != rx_buff_idx)
-                    {
-                        decode_idx = next;
-                        next = ((decode_idx + 1) % RX_BUFF_SIZE);
-                    }
-                    else
-                    {
-                        // End of the buffer reached
-                        break;
-                    }
-                }
+                printk("BT A2DP connection not confirmed\n");
+                bluetooth_drv_at_transact("SCAN=1", NULL, K_MSEC(AT_TIMEOUT_MS), AT_RETRIES);
+                bluetooth_drv_handler.cb(BT_EVT_CONN_FAILED);
             }
+            break;
+        case BT_REQ_SCAN:
+            bluetooth_drv_at_transact("SCAN=1", NULL, K_MSEC(AT_TIMEOUT_MS), AT_RETRIES);
+            break;
+        default:
+            break;
         }
-        // Enable UART interrupt and wait for data to accumulate
-        uart_irq_rx_enable(bluetooth_drv_handler.uart_int);
-        k_sleep(K_MSEC(1));
     }
 }
 
 /**
- * @brief bluetooth_drv_uart_irq_cb
+ * @brief bluetooth_drv_link_up; start streaming on the established link
  *
- * @param dev
- * @param user_data
  */
-static void bluetooth_drv_uart_irq_cb(const struct device *dev, void *user_data)
+static void bluetooth_drv_link_up(void)
 {
-    ARG_UNUSED(user_data);
+    // Start A2DP communication of I2S data received
+    bluetooth_drv_at_transact("AUDROUTE=1", NULL, K_MSEC(AT_TIMEOUT_MS), AT_RETRIES);
+    printk("BT A2DP link up in %d ms\n", (int)(k_uptime_get() - bluetooth_drv_handler.start_ms));
+    bluetooth_drv_handler.cb(BT_EVT_CONNECTED);
+}
 
-    if (!uart_irq_update(dev))
+/**
+ * @brief bluetooth_drv_link_poll; refresh the link status, link losses are published by the decoder
+ *
+ */
+static void bluetooth_drv_link_poll(void)
+{
+    if (!bluetooth_drv_handler.link.up ||
+        (bluetooth_drv_at_transact("A2DPSTAT", "+A2DPSTAT", K_MSEC(AT_TIMEOUT_MS), 0) != 0) ||
+        !bluetooth_drv_handler.link.up)
+    {
         return;
+    }
+
+    if ((bluetooth_drv_at_transact("RSSI", "+RSSI", K_MSEC(AT_TIMEOUT_MS), 0) == 0) &&
+        (bluetooth_drv_handler.bluetooth_drv_status.rssi != BLUETOOTH_DRV_RSSI_UNKNOWN))
+    {
+        struct bluetooth_drv_link_evt evt = {
+            .type = BT_LINK_EVT_QUALITY,
+            .uptime_ms = k_uptime_get_32(),
+            .rssi = (int8_t)bluetooth_drv_handler.bluetooth_drv_status.rssi,
+        };
+
+        k_mutex_lock(&bluetooth_drv_link_mutex, K_FOREVER);
+        bluetooth_drv_handler.link.rssi = evt.rssi;
+        k_mutex_unlock(&bluetooth_drv_link_mutex);
+        bluetooth_drv_evt_publish(&evt);
+    }
+}
+
+/**
+ * @brief bluetooth_drv_evt_thread; link events dispatcher
+ *
+ * @param a
+ * @param b
+ * @param c
+ */
+static void bluetooth_drv_evt_thread(void *a, void *b, void *c)
+{
+    struct bluetooth_drv_link_evt evt;
 
-    while (uart_irq_rx_ready(dev))
+    while (1)
     {
-        int rx = uart_fifo_read(dev, irq_buf, sizeof(irq_buf)); // Read from UART peripheral buffer
-        if (rx > 0)
+        k_msgq_get(&bluetooth_drv_evt_msgq, &evt, K_FOREVER);
+
+        switch (evt.type)
         {
-            // Handle circular buffer space
-            int16_t space_remaining = (RX_BUFF_SIZE - rx_buff_idx);
-            if (rx <= space_remaining)
-            {
-                memcpy(&cmd_buff_rx[rx_buff_idx], irq_buf, rx);
-                rx_buff_idx += rx;
-            }
-            else
-            {
-                memcpy(&cmd_buff_rx[rx_buff_idx], irq_buf, space_remaining);
-                rx_buff_idx = 0;
-                memcpy(&cmd_buff_rx[rx_buff_idx], irq_buf + space_remaining, (rx - space_remaining));
-                rx_buff_idx = (rx - space_remaining);
-            }
-            k_sem_give(&bluetooth_drv_uart_sem);
+        case BT_LINK_EVT_UP:
+            printk("BT link up, %d ms without link\n", (int)evt.down_ms);
+            break;
+        case BT_LINK_EVT_DOWN:
+            printk("BT link lost\n");
+            break;
+        default:
+            break;
+        }
+
+        for (uint8_t i = 0; i < bluetooth_drv_handler.subscriber_num; i++)
+        {
+            bluetooth_drv_handler.subscriber[i](&evt);
         }
     }
 }
 
 /**
- * @brief uart_write_str
+ * @brief bluetooth_drv_evt_publish; queue the event, never waits
  *
- * @param s
+ * @param evt
  */
-static void uart_write_str(const char *s)
+static void bluetooth_drv_evt_publish(const struct bluetooth_drv_link_evt *evt)
 {
-    for (size_t i = 0; i < strlen(s); i++)
+    if (k_msgq_put(&bluetooth_drv_evt_msgq, evt, K_NO_WAIT) != 0)
     {
-        uart_poll_out(bluetooth_drv_handler.uart_int, s[i]);
+        k_mutex_lock(&bluetooth_drv_link_mutex, K_FOREVER);
+        bluetooth_drv_handler.link.evt_dropped++;
+        k_mutex_unlock(&bluetooth_drv_link_mutex);
     }
 }
 
 /**
- * @brief bluetooth_drv_decode_data
+ * @brief bluetooth_drv_reconcile; write the settings and reboot only if the module differs
  *
- * @param s
+ * @param settings
+ * @param settings_n
  * @return int
  */
-static int bluetooth_drv_decode_data(char *s)
+static int bluetooth_drv_reconcile(const struct bluetooth_drv_setting *settings, uint8_t settings_n)
 {
-    char cmd[20] = {0};
-    char data[100] = {0};
-    char *cmd_end = strchr(s, '='); // End of the command part
-    char *data_start = NULL;
+    char cmd[30];
+    bool match = true;
 
-    if (!cmd_end)
+    // Query the current values, answers are parsed by the key table
+    for (uint8_t i = 0; (i < settings_n) && match; i++)
     {
-        // If end not reached it means Ok command or error
+        match = ((bluetooth_drv_at_transact(settings[i].key, settings[i].expect, K_MSEC(AT_TIMEOUT_MS), AT_RETRIES) == 0) &&
+                 (*settings[i].field == settings[i].value));
+    }
 
-        // OK
-        if (strcmp(s, "OK") == 0)
+    if (match)
+    {
+        printk("BT module configuration already matching\n");
+        return 0;
+    }
+
+    // Reset the module to default settings, it restarts afterwards
+    if (bluetooth_drv_at_transact("RESTORE", "+NAME", K_MSEC(AT_BOOT_TIMEOUT_MS), 0) != 0)
+    {
+        printk("BT module not back after restore\n");
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < settings_n; i++)
+    {
+        snprintf(cmd, sizeof(cmd), "%s=%d", settings[i].key, settings[i].value);
+        if (bluetooth_drv_at_transact(cmd, NULL, K_MSEC(AT_TIMEOUT_MS), AT_RETRIES) != 0)
         {
-            bluetooth_drv_handler.bluetooth_drv_status.ok = 1;
-            return 0;
+            return -1;
         }
-        else
+    }
+
+    // Reboot to make changes effective, the module announces itself when ready
+    if (bluetooth_drv_at_transact("REBOOT", "+NAME", K_MSEC(AT_BOOT_TIMEOUT_MS), 0) != 0)
+    {
+        printk("BT module not back after reboot\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief bluetooth_drv_a2dp_connect; wait until the link is established or the timeout expires
+ *
+ * The status is written by the decoder only. The A2DPCONN transaction
+ * completes on a +A2DPSTAT received after it started, so the value checked is
+ * never the one left by a previous link. The following changes are waited on
+ * the status semaphore, which keeps a change arrived between the check and
+ * the wait.
+ *
+ * @param addr
+ * @return int
+ */
+static int bluetooth_drv_a2dp_connect(const struct bluetooth_drv_addr *addr)
+{
+    char cmd[BLUETOOTH_DRV_ADDR_SIZE + 10];
+    int64_t deadline = (k_uptime_get() + AT_CONN_TIMEOUT_MS);
+
+    // Address in the module own format, never rebuilt from the packed bytes
+    snprintf(cmd, sizeof(cmd), "A2DPCONN=%s", addr->str);
+    k_sem_reset(&bluetooth_drv_a2dpstat_sem);
+    if (bluetooth_drv_at_transact(cmd, "+A2DPSTAT", K_MSEC(AT_CONN_TIMEOUT_MS), 0) != 0)
+    {
+        return -1;
+    }
+
+    // Intermediate states are reported too, wait for the connected one
+    while (bluetooth_drv_handler.bluetooth_drv_status.a2dpstat < BT_A2DP_CONNECTED)
+    {
+        int64_t left = (deadline - k_uptime_get());
+
+        if (bluetooth_drv_handler.bluetooth_drv_status.a2dpstat != BT_A2DP_CONNECTING)
+        {
+            return -1; // Back to standby, the peer refused or didn't answer
+        }
+
+        // A status given since the check is kept by the semaphore, the loop checks it again
+        if ((left <= 0) || (k_sem_take(&bluetooth_drv_a2dpstat_sem, K_MSEC(left)) != 0))
         {
             return -1;
         }
     }
 
-    data_start = (cmd_end + 1); // Start of data payload
+    return 0;
+}
 
-    int len = (cmd_end - s);
-    memcpy(cmd, s, len);
-    cmd[len] = '\0';
+/**
+ * @brief bluetooth_drv_mru_connect; try the cached peers, most recent first
+ *
+ * @return int
+ */
+static int bluetooth_drv_mru_connect(void)
+{
+    for (uint8_t i = 0; i < BLUETOOTH_DRV_MRU_SIZE; i++)
+    {
+        struct bluetooth_drv_addr addr = bluetooth_drv_handler.mru[i];
 
-    strcpy(data, data_start);
+        if (addr.str[0] == '\0')
+        {
+            break;
+        }
+
+        printk("BT reconnecting to %s\n", addr.str);
+        if (bluetooth_drv_a2dp_connect(&addr) == 0)
+        {
+            bluetooth_drv_mru_push(&addr);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief bluetooth_drv_mru_push; move the peer on top of the cache and save it
+ *
+ * @param addr
+ */
+static void bluetooth_drv_mru_push(const struct bluetooth_drv_addr *addr)
+{
+    uint8_t i = 0;
 
-    // +DEVSTAT
-    if (strcmp(cmd, "+DEVSTAT") == 0)
+    // Entry to drop, the peer itself if already cached, the oldest one otherwise
+    while ((i < (BLUETOOTH_DRV_MRU_SIZE - 1)) && (memcmp(bluetooth_drv_handler.mru[i].mac, addr->mac, BLUETOOTH_DRV_MAC_LEN) != 0))
     {
-        bluetooth_drv_handler.bluetooth_drv_status.devstat = atoi(data);
-        return 0;
+        i++;
+    }
+    if ((i == 0) && (strcmp(bluetooth_drv_handler.mru[0].str, addr->str) == 0))
+    {
+        return; // Already the most recent, nothing to save
     }
 
-    // +PWRSTAT
-    if (strcmp(cmd, "+PWRSTAT") == 0)
+    memmove(&bluetooth_drv_handler.mru[1], &bluetooth_drv_handler.mru[0], (i * sizeof(struct bluetooth_drv_addr)));
+    bluetooth_drv_handler.mru[0] = *addr;
+
+    if (settings_save_one("bt/mru", bluetooth_drv_handler.mru, sizeof(bluetooth_drv_handler.mru)) != 0)
     {
-        bluetooth_drv_handler.bluetooth_drv_status.pwrstat = atoi(data);
-        return 0;
+        printk("BT peers cache not saved\n");
     }
+}
+
+/**
+ * @brief bluetooth_drv_peers_snapshot; consistent copy of the peers table
+ *
+ * @param peers
+ * @param max
+ * @return uint16_t number of peers copied, strongest first
+ */
+uint16_t bluetooth_drv_peers_snapshot(struct bluetooth_peers *peers, uint16_t max)
+{
+    k_mutex_lock(&bluetooth_drv_peers_mutex, K_FOREVER);
+
+    uint16_t n = MIN(max, bluetooth_drv_handler.peer_num);
+    memcpy(peers, bluetooth_drv_handler.peer, (n * sizeof(struct bluetooth_peers)));
+
+    k_mutex_unlock(&bluetooth_drv_peers_mutex);
 
-    // +VER
-    if (strcmp(cmd, "+VER") == 0)
+    return n;
+}
+
+/**
+ * @brief bluetooth_drv_peers_update; dedupe, drop stale peers and insert by RSSI
+ *
+ * @param peer
+ */
+static void bluetooth_drv_peers_update(const struct bluetooth_peers *peer)
+{
+    struct bluetooth_peers *table = bluetooth_drv_handler.peer;
+    uint16_t n = 0;
+
+    k_mutex_lock(&bluetooth_drv_peers_mutex, K_FOREVER);
+
+    // Compact the table without the old entry of this peer and the stale ones
+    for (uint16_t i = 0; i < bluetooth_drv_handler.peer_num; i++)
     {
-        strncpy(bluetooth_drv_handler.bluetooth_drv_status.ver, data, sizeof(bluetooth_drv_handler.bluetooth_drv_status.ver) - 1);
-        return 0;
+        if ((memcmp(table[i].mac, peer->mac, BLUETOOTH_DRV_MAC_LEN) != 0) &&
+            ((peer->last_seen - table[i].last_seen) < BLUETOOTH_DRV_PEER_STALE_MS))
+        {
+            table[n++] = table[i];
+        }
     }
 
-    // +PROFILE
-    if (strcmp(cmd, "+PROFILE") == 0)
+    // Table full, the weakest peer leaves room only to a stronger one
+    if (n == BLUETOOTH_DRV_MAX_PEERS)
     {
-        bluetooth_drv_handler.bluetooth_drv_status.profile = atoi(data);
-        return 0;
+        if (peer->rssi <= table[n - 1].rssi)
+        {
+            bluetooth_drv_handler.peer_num = n;
+            k_mutex_unlock(&bluetooth_drv_peers_mutex);
+            return;
+        }
+        n--;
     }
 
-    // +SPPSTAT
-    if (strcmp(cmd, "+SPPSTAT") == 0)
+    // Insert after the peers with a stronger or equal signal
+    uint16_t pos = n;
+    while ((pos > 0) && (table[pos - 1].rssi < peer->rssi))
     {
-        bluetooth_drv_handler.bluetooth_drv_status.sppstat = atoi(data);
-        return 0;
+        table[pos] = table[pos - 1];
+        pos--;
     }
+    table[pos] = *peer;
+    bluetooth_drv_handler.peer_num = (n + 1);
+
+    k_mutex_unlock(&bluetooth_drv_peers_mutex);
+}
+
+/**
+ * @brief bluetooth_drv_mac_parse; 12 hex digits, : and - separators allowed
+ *
+ * @param str
+ * @param mac
+ * @return int -1 if the string is not an address
+ */
+static int bluetooth_drv_mac_parse(const char *str, uint8_t *mac)
+{
+    uint8_t digits = 0;
 
-    // +GATTSTAT
-    if (strcmp(cmd, "+GATTSTAT") == 0)
+    for (; *str != '\0'; str++)
     {
-        bluetooth_drv_handler.bluetooth_drv_status.gattstat = atoi(data);
-        return 0;
+        uint8_t nibble;
+
+        if (isdigit((unsigned char)*str))
+        {
+            nibble = (*str - '0');
+        }
+        else if (isxdigit((unsigned char)*str))
+        {
+            nibble = ((toupper((unsigned char)*str) - 'A') + 10);
+        }
+        else if ((*str == ':') || (*str == '-'))
+        {
+            continue; // Separator
+        }
+        else
+        {
+            return -1;
+        }
+
+        if (digits == (2 * BLUETOOTH_DRV_MAC_LEN))
+        {
+            return -1;
+        }
+        mac[digits / 2] = ((digits & 1) ? (mac[digits / 2] | nibble) : (nibble << 4));
+        digits++;
     }
 
-    // +A2DPSTAT
-    if (strcmp(cmd, "+A2DPSTAT") == 0)
+    return (digits == (2 * BLUETOOTH_DRV_MAC_LEN)) ? 0 : -1;
+}
+
+/**
+ * @brief bluetooth_drv_settings_set; "bt" settings subtree loader
+ *
+ * @param key
+ * @param len
+ * @param read_cb
+ * @param cb_arg
+ * @return int
+ */
+static int bluetooth_drv_settings_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+
+    if (settings_name_steq(key, "mru", &next) && !next)
     {
-        bluetooth_drv_handler.bluetooth_drv_status.a2dpstat = atoi(data);
+        if (len != sizeof(bluetooth_drv_handler.mru))
+        {
+            return -EINVAL; // Other layout (packed bytes only), the cache restarts empty
+        }
+        if (read_cb(cb_arg, bluetooth_drv_handler.mru, len) < 0)
+        {
+            memset(bluetooth_drv_handler.mru, 0, sizeof(bluetooth_drv_handler.mru));
+            return -EIO;
+        }
         return 0;
     }
 
-    // +AVRCPSTAT
-    if (strcmp(cmd, "+AVRCPSTAT") == 0)
+    return -ENOENT;
+}
+
+/**
+ * @brief bluetooth_drv_at_transact; send a command and wait for its completion
+ *
+ * A command completes on its OK and, if expect is given, the +KEY line too,
+ * in any order: query answers come before the OK, link and boot
+ * notifications after it.
+ *
+ * @param cmd NULL to wait for an unsolicited +KEY
+ * @param expect +KEY needed by the command, NULL to wait for OK only
+ * @param timeout per attempt
+ * @param retries attempts after the first one
+ * @return int 0 on completion, -1 on ERROR or timeout
+ */
+int bluetooth_drv_at_transact(const char *cmd, const char *expect, k_timeout_t timeout, uint8_t retries)
+{
+    int ret = -1;
+
+    k_mutex_lock(&bluetooth_drv_at_mutex, K_FOREVER);
+
+    for (uint8_t attempt = 0; attempt <= retries; attempt++)
     {
-        bluetooth_drv_handler.bluetooth_drv_status.avrcpstat = atoi(data);
-        return 0;
+        // A timed out command may still be answered, its OK must not complete this one
+        bluetooth_drv_at_drain();
+
+        bluetooth_drv_at.expect = expect;
+        bluetooth_drv_at.key_seen = (expect == NULL);
+        bluetooth_drv_at.final_seen = (cmd == NULL);
+        bluetooth_drv_at.result = -1;
+        k_sem_reset(&bluetooth_drv_at_sem);
+        atomic_set(&bluetooth_drv_at.active, 1);
+
+        if (((cmd == NULL) || (bluetooth_drv_at_send(cmd) == 0)) &&
+            (k_sem_take(&bluetooth_drv_at_sem, timeout) == 0) &&
+            (bluetooth_drv_at.result == 0))
+        {
+            ret = 0;
+            break;
+        }
+        atomic_set(&bluetooth_drv_at.active, 0);
+        printk("BT %s failed, attempt %d\n", ((cmd != NULL) ? cmd : expect), (attempt + 1));
     }
 
-    // +HFPSTAT
-    if (strcmp(cmd, "+HFPSTAT") == 0)
+    atomic_set(&bluetooth_drv_at.active, 0);
+    k_mutex_unlock(&bluetooth_drv_at_mutex);
+
+    return ret;
+}
+
+/**
+ * @brief bluetooth_drv_at_drain; wait for the finals owed by the previous commands
+ *
+ * Finals not arrived within AT_TIMEOUT_MS are considered lost.
+ */
+static void bluetooth_drv_at_drain(void)
+{
+    int64_t deadline = (k_uptime_get() + AT_TIMEOUT_MS);
+
+    while ((atomic_get(&bluetooth_drv_at_pending) > 0) && (k_uptime_get() < deadline))
     {
-        bluetooth_drv_handler.bluetooth_drv_status.hfpstat = atoi(data);
-        return 0;
+        k_sleep(K_MSEC(10));
     }
 
-    // +PBSTAT
-    if (strcmp(cmd, "+PBSTAT") == 0)
+    atomic_set(&bluetooth_drv_at_pending, 0);
+}
+
+/**
+ * @brief bluetooth_drv_get_boot_ms
+ *
+ * @return int64_t
+ */
+int64_t bluetooth_drv_get_boot_ms(void)
+{
+    return bluetooth_drv_handler.boot_ms;
+}
+
+/**
+ * @brief bluetooth_drv_at_send; queue the command, the transfer runs on DMA
+ *
+ * @param cmd
+ * @return int
+ */
+int bluetooth_drv_at_send(const char *cmd)
+{
+    struct bluetooth_drv_tx_cmd msg;
+
+    strcpy(msg.str, "AT+");
+    strncat(msg.str, cmd, sizeof(msg.str) - strlen(msg.str) - 1);
+    strncat(msg.str, "\r\n", sizeof(msg.str) - strlen(msg.str) - 1);
+
+    if (k_msgq_put(&bluetooth_drv_tx_msgq, &msg, K_NO_WAIT) != 0)
     {
-        bluetooth_drv_handler.bluetooth_drv_status.pbstat = atoi(data);
-        return 0;
+        printk("BT TX queue full, %s dropped\n", cmd);
+        return -1;
     }
+    atomic_inc(&bluetooth_drv_at_pending);
 
-    // +NAME
-    if (strcmp(cmd, "+NAME") == 0)
+    // Start the transfer if the UART is idle, otherwise TX_DONE picks the command
+    if (atomic_cas(&tx_busy, 0, 1))
     {
-        strncpy(bluetooth_drv_handler.bluetooth_drv_status.name, data, sizeof(bluetooth_drv_handler.bluetooth_drv_status.name) - 1);
-        return 0;
+        bluetooth_drv_tx_next();
     }
 
-    // +I2SCFG
-    if (strcmp(cmd, "+I2SCFG") == 0)
+    return 0;
+}
+
+/**
+ * @brief bluetooth_drv_rx_overruns; received bytes overwritten before being decoded
+ *
+ * @return uint32_t
+ */
+uint32_t bluetooth_drv_rx_overruns(void)
+{
+    return rx_overruns;
+}
+
+/**
+ * @brief bluetooth_drv_decode_thread
+ *
+ * @param a
+ * @param b
+ * @param c
+ */
+static void bluetooth_drv_decode_thread(void *a, void *b, void *c)
+{
+    uint16_t decode_idx = 0;
+
+    while (1)
     {
-        bluetooth_drv_handler.bluetooth_drv_status.i2scfg = atoi(data);
-        return 0;
+        // Wait for at least a complete line in the RX buffer
+        k_sem_take(&bluetooth_drv_uart_sem, K_FOREVER);
+
+        if (atomic_cas(&rx_resync, 1, 0))
+        {
+            // Partial line left behind, the corrupted data check skips up to the next \r\n
+            printk("BT RX overrun, %u so far\n", rx_overruns);
+            decode_idx = rx_buff_idx;
+            rx_decode_idx = decode_idx;
+        }
+
+        // Decode every packet received so far, corrupted data is skipped
+        struct bluetooth_line line;
+        enum bluetooth_line_next_e next;
+
+        while ((next = bluetooth_line_next(cmd_buff_rx, RX_BUFF_SIZE, &decode_idx, rx_buff_idx, &line)) != BT_LINE_NONE)
+        {
+            if (next == BT_LINE_FRAMED)
+            {
+                bluetooth_drv_decode_data(&line);
+            }
+            // Only now the line can be overwritten
+            rx_decode_idx = decode_idx;
+        }
     }
+}
+
+/**
+ * @brief bluetooth_drv_uart_cb
+ *
+ * @param dev
+ * @param evt
+ * @param user_data
+ */
+static void bluetooth_drv_uart_cb(const struct device *dev, struct uart_event *evt, void *user_data)
+{
+    ARG_UNUSED(user_data);
 
-    // +SCAN
-    if (strcmp(cmd, "+SCAN") == 0)
+    switch (evt->type)
     {
-        if (bluetooth_drv_handler.peer_num >= BLUETOOTH_DRV_MAX_PEERS)
+    case UART_RX_RDY:
+    {
+        const uint8_t *data = &evt->data.rx.buf[evt->data.rx.offset];
+
+        bluetooth_drv_rx_done(data, evt->data.rx.len);
+
+        // Wake up the decoder only when a line is complete
+        if (memchr(data, '\n', evt->data.rx.len) != NULL)
         {
-            return 0;
+            k_sem_give(&bluetooth_drv_uart_sem);
+        }
+        break;
+    }
+    case UART_RX_BUF_REQUEST:
+        // Next chunk of the ring, chunks are aligned after the first one
+        uart_rx_buf_rsp(dev, &cmd_buff_rx[rx_dma_next], RX_DMA_BUFF_SIZE);
+        rx_dma_next = ((rx_dma_next + RX_DMA_BUFF_SIZE) % RX_BUFF_SIZE);
+        break;
+    case UART_RX_DISABLED:
+        // Reception stopped (e.g. line error), restart it
+        bluetooth_drv_rx_enable();
+        break;
+    case UART_TX_DONE:
+    case UART_TX_ABORTED:
+        // Back to back transfer of the queued commands
+        bluetooth_drv_tx_next();
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief bluetooth_drv_rx_enable; (re)start the reception at the write index, up to the end of its chunk
+ *
+ * @return int
+ */
+static int bluetooth_drv_rx_enable(void)
+{
+    uint16_t start = rx_buff_idx;
+    uint16_t len = (RX_DMA_BUFF_SIZE - (start % RX_DMA_BUFF_SIZE));
+
+    rx_dma_next = ((start + len) % RX_BUFF_SIZE);
+    return uart_rx_enable(bluetooth_drv_handler.uart_int, &cmd_buff_rx[start], len, RX_IDLE_TIMEOUT_US);
+}
+
+/**
+ * @brief bluetooth_drv_rx_done; bytes written in the ring by the DMA, move the write index
+ *
+ * NOTE; RX_RDY comes at least once per chunk, so the DMA can't run more than
+ *       a chunk ahead of the check
+ *
+ * @param data
+ * @param len
+ */
+static void bluetooth_drv_rx_done(const uint8_t *data, size_t len)
+{
+    uint16_t head = rx_buff_idx;
+    uint16_t unread = ((head + RX_BUFF_SIZE - rx_decode_idx) % RX_BUFF_SIZE);
+
+    // One byte is kept free, a full ring would look empty
+    if ((unread + len) >= RX_BUFF_SIZE)
+    {
+        rx_overruns++;
+        atomic_set(&rx_resync, 1);
+    }
+
+    rx_buff_idx = (((data - cmd_buff_rx) + len) % RX_BUFF_SIZE);
+}
+
+/**
+ * @brief bluetooth_drv_tx_next; start the next queued command or release the UART
+ *
+ * NOTE; called with tx_busy set, from thread or UART ISR context
+ */
+static void bluetooth_drv_tx_next(void)
+{
+    if (k_msgq_get(&bluetooth_drv_tx_msgq, &tx_cmd, K_NO_WAIT) == 0)
+    {
+        if (uart_tx(bluetooth_drv_handler.uart_int, (const uint8_t *)tx_cmd.str, strlen(tx_cmd.str), SYS_FOREVER_US) == 0)
+        {
+            return;
         }
-        extract_name(data, &bluetooth_drv_handler.peer[bluetooth_drv_handler.peer_num]);
-        extract_mac(data, &bluetooth_drv_handler.peer[bluetooth_drv_handler.peer_num]);
-        bluetooth_drv_handler.peer_num++;
+        printk("BT UART TX failed\n");
+    }
+    atomic_clear(&tx_busy);
+}
+
+/**
+ * @brief bluetooth_drv_decode_data
+ *
+ * @param line
+ * @return int
+ */
+static int bluetooth_drv_decode_data(const struct bluetooth_line *line)
+{
+    uint16_t len = bluetooth_line_len(line);
+    uint16_t key_len = bluetooth_line_key_len(line); // Key part ends at =
+
+    if (key_len == len)
+    {
+        // If end not reached it means Ok command or error
+
+        // OK
+        if (bluetooth_line_equals(line, 0, len, "OK"))
+        {
+            bluetooth_drv_handler.bluetooth_drv_status.ok = 1;
+        }
+        bluetooth_drv_at_complete(line, key_len);
         return 0;
     }
-    return -1;
+
+    const struct bluetooth_line_key *entry = bluetooth_line_key_find(line, key_len, bluetooth_drv_keys, ARRAY_SIZE(bluetooth_drv_keys));
+
+    if (entry != NULL)
+    {
+        entry->handler(line, (key_len + 1), entry->arg, entry->size);
+    }
+    bluetooth_drv_at_complete(line, key_len);
+
+    return (entry != NULL) ? 0 : -1;
 }
 
 /**
- * @brief extract_name
+ * @brief bluetooth_drv_at_complete; account the line to the pending transaction, signal it once complete
  *
- * @param input
- * @param peer
+ * @param line
+ * @param key_len length of the +KEY part, whole line if no = is present
  */
-static void extract_name(const char *input, struct bluetooth_peers *peer)
+static void bluetooth_drv_at_complete(const struct bluetooth_line *line, uint16_t key_len)
 {
-    uint8_t comma_num = 0;
-    size_t written = 0;
-    char *name_out = peer->name;
-    size_t max_len = sizeof(peer->name);
+    uint16_t len = bluetooth_line_len(line);
+    bool error = bluetooth_line_equals(line, 0, len, "ERROR");
+    bool final = (error || bluetooth_line_equals(line, 0, len, "OK"));
+    atomic_val_t owed = 0;
 
-    // Peer name is in the 5th field (fields are separated by ,)
-    while (comma_num < 4 && *input)
+    if (final)
     {
-        if (*input == ',')
+        // One final less owed, never below zero on unsolicited lines
+        do
         {
-            comma_num++;
+            owed = atomic_get(&bluetooth_drv_at_pending);
+        } while ((owed > 0) && !atomic_cas(&bluetooth_drv_at_pending, owed, (owed - 1)));
+    }
+
+    if (!atomic_get(&bluetooth_drv_at.active))
+    {
+        return;
+    }
+
+    const char *expect = bluetooth_drv_at.expect;
+
+    if (final)
+    {
+        if ((owed != 1) || bluetooth_drv_at.final_seen)
+        {
+            return; // Answer of an older command
+        }
+        bluetooth_drv_at.final_seen = true;
+        if (error)
+        {
+            atomic_set(&bluetooth_drv_at.active, 0);
+            k_sem_give(&bluetooth_drv_at_sem);
+            return;
         }
-        input++;
+    }
+    else if ((expect != NULL) && (key_len < len) && bluetooth_line_equals(line, 0, key_len, expect))
+    {
+        bluetooth_drv_at.key_seen = true;
     }
 
-    // Extract the peer's name
-    while (*input != ',' && *input != '\0' && written < max_len - 1)
+    if (bluetooth_drv_at.key_seen && bluetooth_drv_at.final_seen)
     {
-        *name_out = *input;
-        name_out++;
-        input++;
-        written++;
+        bluetooth_drv_at.result = 0;
+        atomic_set(&bluetooth_drv_at.active, 0);
+        k_sem_give(&bluetooth_drv_at_sem);
     }
+}
+
+/**
+ * @brief bluetooth_drv_on_int; integer status value
+ *
+ * @param line
+ * @param val
+ * @param arg
+ * @param size
+ */
+static void bluetooth_drv_on_int(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size)
+{
+    ARG_UNUSED(size);
 
-    return;
+    *(int *)arg = bluetooth_line_int(line, val);
 }
 
 /**
- * @brief extract_mac
+ * @brief bluetooth_drv_on_str; string status value
  *
- * @param input
- * @param peer
+ * @param line
+ * @param val
+ * @param arg
+ * @param size
+ */
+static void bluetooth_drv_on_str(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size)
+{
+    bluetooth_line_field(line, val, BLUETOOTH_LINE_WHOLE, arg, size); // Whole value, commas included
+}
+
+/**
+ * @brief bluetooth_drv_on_scan; advertised peer
+ *
+ * @param line
+ * @param val
+ * @param arg
+ * @param size
  */
-static void extract_mac(const char *input, struct bluetooth_peers *peer)
+static void bluetooth_drv_on_scan(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size)
 {
-    uint8_t comma_num = 0;
-    size_t written = 0;
-    char *mac_out = peer->mac;
-    size_t max_len = sizeof(peer->mac);
+    ARG_UNUSED(arg);
+    ARG_UNUSED(size);
 
-    // Peer name is in the 4th field (fields are separated by ,)
-    while (comma_num < 3 && *input)
+    struct bluetooth_peers peer = {.rssi = BLUETOOTH_DRV_RSSI_UNKNOWN};
+    uint16_t len = bluetooth_line_len(line);
+    uint8_t field = 0;
+
+    // Fields are told apart by their content, not by their position: the
+    // address is the first one made of 12 hex digits, the name follows it,
+    // the RSSI is the only negative value (index and flags are not).
+    for (uint16_t pos = val; pos < len; pos = bluetooth_line_field_pos(line, val, ++field))
     {
-        if (*input == ',')
+        char str[BLUETOOTH_DRV_ADDR_SIZE + 1]; // One more, a longer field is not taken for an address
+
+        if ((bluetooth_line_at(line, pos) == '-') && ((pos + 1) < len) &&
+            isdigit((unsigned char)bluetooth_line_at(line, (pos + 1))) && (peer.rssi == BLUETOOTH_DRV_RSSI_UNKNOWN))
+        {
+            peer.rssi = (int8_t)CLAMP(bluetooth_line_int(line, pos), (INT8_MIN + 1), -1);
+        }
+        else if ((peer.addr[0] == '\0') &&
+                 (bluetooth_line_field(line, val, field, str, sizeof(str)) < BLUETOOTH_DRV_ADDR_SIZE) &&
+                 (bluetooth_drv_mac_parse(str, peer.mac) == 0))
         {
-            comma_num++;
+            strcpy(peer.addr, str);
+            field++; // The name, whatever it starts with
+            bluetooth_line_field(line, val, field, peer.name, sizeof(peer.name));
         }
-        input++;
     }
 
-    // Extract the peer's MAC address
-    while (*input != ',' && *input != '\0' && written < max_len - 1)
+    if (peer.addr[0] == '\0')
+    {
+        return;
+    }
+    peer.last_seen = k_uptime_get_32();
+
+    bluetooth_drv_peers_update(&peer);
+}
+
+/**
+ * @brief bluetooth_drv_on_a2dpstat; A2DP link status, transitions are published
+ *
+ * @param line
+ * @param val
+ * @param arg
+ * @param size
+ */
+static void bluetooth_drv_on_a2dpstat(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size)
+{
+    struct bluetooth_drv_link_stats *link = &bluetooth_drv_handler.link;
+    struct bluetooth_drv_link_evt evt = {.uptime_ms = k_uptime_get_32()};
+
+    bluetooth_drv_on_int(line, val, arg, size);
+    k_sem_give(&bluetooth_drv_a2dpstat_sem);
+
+    bool up = (*(int *)arg >= BT_A2DP_CONNECTED);
+    if (up == link->up)
+    {
+        return;
+    }
+
+    k_mutex_lock(&bluetooth_drv_link_mutex, K_FOREVER);
+    link->up = up;
+
+    if (up)
+    {
+        evt.type = BT_LINK_EVT_UP;
+        evt.down_ms = (evt.uptime_ms - bluetooth_drv_handler.down_since_ms);
+        if (bluetooth_drv_handler.link_lost)
+        {
+            // Reconnection, the first link up is accounted in the boot time
+            link->reconnects++;
+            link->last_down_ms = evt.down_ms;
+            link->max_down_ms = MAX(link->max_down_ms, evt.down_ms);
+        }
+    }
+    else
     {
-        *mac_out = *input;
-        mac_out++;
-        input++;
-        written++;
+        evt.type = BT_LINK_EVT_DOWN;
+        bluetooth_drv_handler.down_since_ms = evt.uptime_ms;
+        bluetooth_drv_handler.link_lost = true;
     }
+    k_mutex_unlock(&bluetooth_drv_link_mutex);
+
+    bluetooth_drv_evt_publish(&evt);
+}
+
+/**
+ * @brief bluetooth_drv_on_rssi; link RSSI, BLUETOOTH_DRV_RSSI_UNKNOWN if not found
+ *
+ * The value is taken as the first negative field, so that a link index or
+ * the peer address ahead of it doesn't matter. A 0 or positive reading is
+ * not a dBm value (e.g. an offset from the golden range) and is not reported.
+ *
+ * @param line
+ * @param val
+ * @param arg
+ * @param size
+ */
+static void bluetooth_drv_on_rssi(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size)
+{
+    ARG_UNUSED(size);
 
-    return;
+    uint16_t len = bluetooth_line_len(line);
+    uint8_t field = 0;
+
+    *(int *)arg = BLUETOOTH_DRV_RSSI_UNKNOWN;
+    for (uint16_t pos = val; pos < len; pos = bluetooth_line_field_pos(line, val, ++field))
+    {
+        if ((bluetooth_line_at(line, pos) == '-') && ((pos + 1) < len) && isdigit((unsigned char)bluetooth_line_at(line, (pos + 1))))
+        {
+            *(int *)arg = CLAMP(bluetooth_line_int(line, pos), (INT8_MIN + 1), -1);
+            return;
+        }
+    }
 }
@@ -1,22 +1,75 @@
 #ifndef BLUETOOTH_DRV_H
 #define BLUETOOTH_DRV_H
 
+#include <zephyr/kernel.h>
 #include <zephyr/device.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #define BT103036C_CONFIG_TX 0
 #define BT103036C_CONFIG_RX 1
 
+#define BLUETOOTH_DRV_MAX_PEERS 10
+#define BLUETOOTH_DRV_MAC_LEN 6
+#define BLUETOOTH_DRV_NAME_SIZE 24
+#define BLUETOOTH_DRV_ADDR_SIZE 18 // Address string, separators included
+#define BLUETOOTH_DRV_RSSI_UNKNOWN INT8_MIN
+
 struct bluetooth_peers
 {
-    char name[100];
-    char mac[100];
+    uint8_t mac[BLUETOOTH_DRV_MAC_LEN];   // Packed, for comparisons
+    char addr[BLUETOOTH_DRV_ADDR_SIZE]; // As reported by +SCAN, A2DPCONN gets it back unchanged
+    int8_t rssi;                          // dBm, BLUETOOTH_DRV_RSSI_UNKNOWN if not reported
+    char name[BLUETOOTH_DRV_NAME_SIZE];
+    uint32_t last_seen; // Uptime of the last advertisement, ms
+};
+
+enum bluetooth_drv_evt_e
+{
+    BT_EVT_SCANNING = 0, // No known peer answered, select one with bluetooth_drv_connect()
+    BT_EVT_CONNECTED,    // A2DP link up and streaming
+    BT_EVT_CONN_FAILED,  // Selected peer not connected, scanning again
+};
+
+typedef void (*bt1036c_evt_cb)(enum bluetooth_drv_evt_e evt); // Callback function for link events, called from the bt thread
+
+enum bluetooth_drv_link_evt_e
+{
+    BT_LINK_EVT_UP = 0,  // A2DP link established
+    BT_LINK_EVT_DOWN,    // A2DP link lost
+    BT_LINK_EVT_QUALITY, // Periodic poll of the established link
+};
+
+struct bluetooth_drv_link_evt
+{
+    enum bluetooth_drv_link_evt_e type;
+    uint32_t uptime_ms;
+    uint32_t down_ms; // BT_LINK_EVT_UP; time spent without link (since config for the first one)
+    int8_t rssi;      // BT_LINK_EVT_QUALITY; dBm
+};
+
+struct bluetooth_drv_link_stats
+{
+    bool up;
+    int8_t rssi;           // Last polled value, dBm
+    uint16_t reconnects;   // Link established again after a loss
+    uint16_t evt_dropped;  // Events lost on a full queue
+    uint32_t last_down_ms; // Duration of the last link loss
+    uint32_t max_down_ms;  // Longest link loss
 };
 
-typedef uint16_t (*bt1036c_peers_cb)(const struct bluetooth_peers *peers, const int16_t *size); // Callback function for peers setting
+typedef void (*bluetooth_drv_link_cb)(const struct bluetooth_drv_link_evt *evt); // Link state subscriber, called from the bt event thread
 
-int bluetooth_drv_config(const struct device *uart, bt1036c_peers_cb cb, const uint8_t txrx_config);
-void bluetooth_drv_at_send(const char *cmd);
+int bluetooth_drv_config(const struct device *uart, bt1036c_evt_cb cb, const uint8_t txrx_config);
+int bluetooth_drv_connect(const struct bluetooth_peers *peer);
+int bluetooth_drv_scan(void);
+int bluetooth_drv_at_send(const char *cmd);
+int bluetooth_drv_at_transact(const char *cmd, const char *expect, k_timeout_t timeout, uint8_t retries);
+int64_t bluetooth_drv_get_boot_ms(void);
+uint16_t bluetooth_drv_peers_snapshot(struct bluetooth_peers *peers, uint16_t max);
+int bluetooth_drv_link_subscribe(bluetooth_drv_link_cb cb);
+void bluetooth_drv_link_get_stats(struct bluetooth_drv_link_stats *stats);
+uint32_t bluetooth_drv_rx_overruns(void);
 
 #endif // BLUETOOTH_DRV_H
@@ -0,0 +1,270 @@
+/*
+ * Bluetooth module line parser
+ * AT answers framed in place in the RX ring, no Zephyr dependency
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "bluetooth_line.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define BLUETOOTH_LINE_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+static int bluetooth_line_key_cmp(const void *key, const void *entry);
+
+/**
+ * @brief bluetooth_line_next; frame the next \r\n<line>\r\n packet or skip corrupted data
+ *
+ * @param ring RX ring
+ * @param size ring size
+ * @param idx read index, moved forward past the data consumed
+ * @param head write index
+ * @param line framed line, trailing \r excluded
+ * @return enum bluetooth_line_next_e
+ */
+enum bluetooth_line_next_e bluetooth_line_next(const uint8_t *ring, uint16_t size, uint16_t *idx, uint16_t head, struct bluetooth_line *line)
+{
+    uint16_t from = *idx;
+
+    // Consider the distance between the two indexes
+    // NOTE; summing size is necessary to consider also the case in which
+    //       head is one turn haed compared to idx
+    uint16_t dist = (head + size - *idx) % size;
+    if (dist <= 2) // Condition needed because each packet starts with \r\n
+    {
+        return BT_LINE_NONE;
+    }
+
+    uint16_t next = ((*idx + 1) % size);
+
+    if ((ring[*idx] == '\r') && (ring[next] == '\n'))
+    {
+        uint16_t start = (*idx + 2) % size; // Start of the packet received
+        uint16_t len = (head + size - start) % size;
+        const char *first = (const char *)&ring[start];
+        uint16_t first_len = BLUETOOTH_LINE_MIN(len, (size - start));
+        const char *end = memchr(first, '\n', first_len);
+
+        // Search the end sequence \n, on the wrapped part too
+        if (end != NULL)
+        {
+            len = (end - first);
+        }
+        else if ((end = memchr(ring, '\n', (len - first_len))) != NULL)
+        {
+            len = (first_len + (end - (const char *)ring));
+        }
+        else
+        {
+            return BT_LINE_NONE; // Packet not complete yet
+        }
+
+        // Frame the line in place, trailing \r excluded
+        line->span[0] = first;
+        line->span[1] = (const char *)ring;
+        line->len[0] = BLUETOOTH_LINE_MIN(len, first_len);
+        line->len[1] = (len > first_len) ? (len - first_len) : 0;
+        if ((len > 0) && (bluetooth_line_at(line, (len - 1)) == '\r'))
+        {
+            line->len[(line->len[1] > 0) ? 1 : 0]--;
+        }
+
+        // Next packet starts after the \n, with its own \r\n
+        *idx = (start + len + 1) % size;
+        return BT_LINE_FRAMED;
+    }
+
+    // No \r\n sequence, data corrupted: search for it in the remaining buffer
+    while ((ring[*idx] != '\r') || (ring[next] != '\n'))
+    {
+        if (next == head)
+        {
+            break; // End of the buffer reached
+        }
+        *idx = next;
+        next = ((*idx + 1) % size);
+    }
+
+    return (*idx != from) ? BT_LINE_SKIPPED : BT_LINE_NONE;
+}
+
+/**
+ * @brief bluetooth_line_key_len; length of the +KEY part, whole line if no = is present
+ *
+ * @param line
+ * @return uint16_t
+ */
+uint16_t bluetooth_line_key_len(const struct bluetooth_line *line)
+{
+    uint16_t len = bluetooth_line_len(line);
+    uint16_t key_len = 0;
+
+    while ((key_len < len) && (bluetooth_line_at(line, key_len) != '='))
+    {
+        key_len++;
+    }
+
+    return key_len;
+}
+
+/**
+ * @brief bluetooth_line_key_find; table entry of the line key
+ *
+ * @param line
+ * @param key_len
+ * @param keys sorted by key, strcmp ordering
+ * @param keys_n
+ * @return const struct bluetooth_line_key* NULL if unknown
+ */
+const struct bluetooth_line_key *bluetooth_line_key_find(const struct bluetooth_line *line, uint16_t key_len, const struct bluetooth_line_key *keys, size_t keys_n)
+{
+    struct bluetooth_line key = {
+        .span = {line->span[0], line->span[1]},
+        .len = {BLUETOOTH_LINE_MIN(key_len, line->len[0]), (key_len > line->len[0]) ? (key_len - line->len[0]) : 0},
+    };
+
+    return bsearch(&key, keys, keys_n, sizeof(keys[0]), bluetooth_line_key_cmp);
+}
+
+/**
+ * @brief bluetooth_line_equals; n characters from the line against a whole string
+ *
+ * @param line
+ * @param from
+ * @param n
+ * @param str
+ * @return bool
+ */
+bool bluetooth_line_equals(const struct bluetooth_line *line, uint16_t from, uint16_t n, const char *str)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        if ((str[i] == '\0') || (bluetooth_line_at(line, (from + i)) != str[i]))
+        {
+            return false;
+        }
+    }
+    return (str[n] == '\0');
+}
+
+/**
+ * @brief bluetooth_line_int; decimal value, stops at the first non digit character
+ *
+ * @param line
+ * @param from
+ * @return int32_t
+ */
+int32_t bluetooth_line_int(const struct bluetooth_line *line, uint16_t from)
+{
+    uint16_t len = bluetooth_line_len(line);
+    int32_t sign = 1;
+    int32_t val = 0;
+
+    if ((from < len) && (bluetooth_line_at(line, from) == '-'))
+    {
+        sign = -1;
+        from++;
+    }
+
+    for (; from < len; from++)
+    {
+        char c = bluetooth_line_at(line, from);
+
+        if (!isdigit((unsigned char)c))
+        {
+            break;
+        }
+        val = ((val * 10) + (c - '0'));
+    }
+
+    return (sign * val);
+}
+
+/**
+ * @brief bluetooth_line_field_pos; start of a comma separated field of the value
+ *
+ * @param line
+ * @param from start of the value
+ * @param field field index, BLUETOOTH_LINE_WHOLE for the whole value
+ * @return uint16_t
+ */
+uint16_t bluetooth_line_field_pos(const struct bluetooth_line *line, uint16_t from, uint8_t field)
+{
+    uint16_t len = bluetooth_line_len(line);
+    uint8_t comma_num = 0;
+
+    // Skip the previous fields
+    while ((field != BLUETOOTH_LINE_WHOLE) && (comma_num < field) && (from < len))
+    {
+        if (bluetooth_line_at(line, from) == ',')
+        {
+            comma_num++;
+        }
+        from++;
+    }
+
+    return from;
+}
+
+/**
+ * @brief bluetooth_line_field; copy a comma separated field of the value
+ *
+ * @param line
+ * @param from start of the value
+ * @param field field index, BLUETOOTH_LINE_WHOLE for the whole value
+ * @param out
+ * @param size
+ * @return uint16_t number of characters copied
+ */
+uint16_t bluetooth_line_field(const struct bluetooth_line *line, uint16_t from, uint8_t field, char *out, size_t size)
+{
+    uint16_t len = bluetooth_line_len(line);
+    uint16_t written = 0;
+
+    from = bluetooth_line_field_pos(line, from, field);
+
+    // Extract the field
+    while ((from < len) && (written < (size - 1)))
+    {
+        char c = bluetooth_line_at(line, from);
+
+        if ((field != BLUETOOTH_LINE_WHOLE) && (c == ','))
+        {
+            break;
+        }
+        out[written++] = c;
+        from++;
+    }
+    out[written] = '\0';
+
+    return written;
+}
+
+/**
+ * @brief bluetooth_line_key_cmp; framed key against a table entry, strcmp ordering
+ *
+ * @param key
+ * @param entry
+ * @return int
+ */
+static int bluetooth_line_key_cmp(const void *key, const void *entry)
+{
+    const struct bluetooth_line *line = key;
+    const char *str = ((const struct bluetooth_line_key *)entry)->key;
+    uint16_t len = bluetooth_line_len(line);
+
+    for (uint16_t i = 0;; i++)
+    {
+        unsigned char c1 = (i < len) ? (unsigned char)bluetooth_line_at(line, i) : '\0';
+        unsigned char c2 = (unsigned char)str[i];
+
+        if ((c1 != c2) || (c1 == '\0'))
+        {
+            return (c1 - c2);
+        }
+    }
+}
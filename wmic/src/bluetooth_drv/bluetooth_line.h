@@ -0,0 +1,66 @@
+#ifndef BLUETOOTH_LINE_H
+#define BLUETOOTH_LINE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BLUETOOTH_LINE_WHOLE 0xFF // Field index of the whole value, commas included
+
+// Received line framed in place in the RX ring, second span used on wrap around
+struct bluetooth_line
+{
+    const char *span[2];
+    uint16_t len[2];
+};
+
+enum bluetooth_line_next_e
+{
+    BT_LINE_NONE = 0, // No complete line yet
+    BT_LINE_FRAMED,   // Line framed, index moved after it
+    BT_LINE_SKIPPED,  // Corrupted data skipped up to the next \r\n
+};
+
+typedef void (*bluetooth_line_handler)(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size); // Handler of a +KEY=value line
+
+struct bluetooth_line_key
+{
+    const char *key;
+    bluetooth_line_handler handler;
+    void *arg;
+    size_t size;
+};
+
+enum bluetooth_line_next_e bluetooth_line_next(const uint8_t *ring, uint16_t size, uint16_t *idx, uint16_t head, struct bluetooth_line *line);
+uint16_t bluetooth_line_key_len(const struct bluetooth_line *line);
+const struct bluetooth_line_key *bluetooth_line_key_find(const struct bluetooth_line *line, uint16_t key_len, const struct bluetooth_line_key *keys, size_t keys_n);
+
+bool bluetooth_line_equals(const struct bluetooth_line *line, uint16_t from, uint16_t n, const char *str);
+int32_t bluetooth_line_int(const struct bluetooth_line *line, uint16_t from);
+uint16_t bluetooth_line_field_pos(const struct bluetooth_line *line, uint16_t from, uint8_t field);
+uint16_t bluetooth_line_field(const struct bluetooth_line *line, uint16_t from, uint8_t field, char *out, size_t size);
+
+/**
+ * @brief bluetooth_line_at
+ *
+ * @param line
+ * @param i
+ * @return char
+ */
+static inline char bluetooth_line_at(const struct bluetooth_line *line, uint16_t i)
+{
+    return (i < line->len[0]) ? line->span[0][i] : line->span[1][i - line->len[0]];
+}
+
+/**
+ * @brief bluetooth_line_len
+ *
+ * @param line
+ * @return uint16_t
+ */
+static inline uint16_t bluetooth_line_len(const struct bluetooth_line *line)
+{
+    return (line->len[0] + line->len[1]);
+}
+
+#endif // BLUETOOTH_LINE_H
@@ -0,0 +1,271 @@
+/*
+ * Boot orchestrator
+ * Init stages run on a worker pool as soon as their dependencies are done
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#include <string.h>
+
+#include "boot.h"
+
+#define BOOT_WORKERS_MAX 4 // One per stage without dependencies (GPIO, DSP, UI, BT)
+#define BOOT_WORKER_STACK 3072 // BT config runs its AT transactions here
+#define BOOT_WORKER_PRIORITY 6
+#define BOOT_WORKER_EXIT 0xFF
+
+K_MSGQ_DEFINE(boot_ready_msgq, sizeof(uint8_t), BOOT_MAX_STAGES, 1);
+K_MSGQ_DEFINE(boot_done_msgq, sizeof(uint8_t), BOOT_MAX_STAGES, 1);
+K_THREAD_STACK_ARRAY_DEFINE(boot_worker_stack, BOOT_WORKERS_MAX, BOOT_WORKER_STACK);
+
+struct boot_handler_t
+{
+    const struct boot_stage *stages;
+    struct boot_stage_stats stats[BOOT_MAX_STAGES];
+    uint8_t stages_n;
+    uint8_t workers_n;
+    uint32_t done_us;
+    uint32_t audio_us;
+    atomic_t audio_marked;
+} static boot_handler;
+
+static struct k_thread boot_worker_tcb[BOOT_WORKERS_MAX];
+
+static void boot_worker(void *a, void *b, void *c);
+static uint32_t boot_now_us(void);
+static void boot_report(void);
+
+/**
+ * @brief boot_run; runs the stages on the worker pool as soon as their
+ * dependencies are done, returns when every stage has completed
+ *
+ * @param stages
+ * @param stages_n
+ * @return int -1 if a fatal stage failed or could not run
+ */
+int boot_run(const struct boot_stage *stages, uint8_t stages_n)
+{
+    uint32_t all = (BOOT_DEP(stages_n) - 1);
+    uint32_t launched = 0;
+    uint32_t done = 0;
+    uint32_t failed = 0;
+    uint8_t roots = 0;
+    int ret = 0;
+
+    if ((stages_n == 0) || (stages_n > BOOT_MAX_STAGES))
+    {
+        return -1;
+    }
+
+    boot_handler.stages = stages;
+    boot_handler.stages_n = stages_n;
+    memset(boot_handler.stats, 0, sizeof(boot_handler.stats));
+
+    // A worker for each stage that can start at once, none of them waits for a free worker
+    for (uint8_t i = 0; i < stages_n; i++)
+    {
+        roots += (stages[i].deps == 0);
+    }
+    if (roots > BOOT_WORKERS_MAX)
+    {
+        printk("Boot: %u independent stages on %u workers\n", roots, BOOT_WORKERS_MAX);
+    }
+    boot_handler.workers_n = CLAMP(roots, 1, BOOT_WORKERS_MAX);
+
+    for (int i = 0; i < boot_handler.workers_n; i++)
+    {
+        k_thread_create(&boot_worker_tcb[i],
+                        boot_worker_stack[i],
+                        K_THREAD_STACK_SIZEOF(boot_worker_stack[i]),
+                        boot_worker,
+                        NULL, NULL, NULL,
+                        BOOT_WORKER_PRIORITY, 0, K_NO_WAIT);
+    }
+
+    while (done != all)
+    {
+        bool progress = true;
+
+        // Launch every stage whose dependencies are done
+        while (progress)
+        {
+            progress = false;
+            for (uint8_t i = 0; i < stages_n; i++)
+            {
+                uint32_t bit = BOOT_DEP(i);
+
+                if ((launched & bit) || ((stages[i].deps & ~done) != 0))
+                {
+                    continue;
+                }
+
+                launched |= bit;
+                if (stages[i].deps & failed)
+                {
+                    // Dependency failed, the stage is skipped
+                    boot_handler.stats[i].result = -1;
+                    done |= bit;
+                    failed |= bit;
+                    progress = true;
+                }
+                else
+                {
+                    k_msgq_put(&boot_ready_msgq, &i, K_FOREVER);
+                }
+            }
+        }
+
+        if ((launched & ~done) == 0)
+        {
+            break; // Nothing running, the remaining dependencies can't be met
+        }
+
+        uint8_t id;
+
+        k_msgq_get(&boot_done_msgq, &id, K_FOREVER);
+        done |= BOOT_DEP(id);
+        if (boot_handler.stats[id].result < 0)
+        {
+            failed |= BOOT_DEP(id);
+        }
+    }
+
+    // Release the workers
+    for (int i = 0; i < boot_handler.workers_n; i++)
+    {
+        uint8_t id = BOOT_WORKER_EXIT;
+
+        k_msgq_put(&boot_ready_msgq, &id, K_FOREVER);
+    }
+
+    boot_handler.done_us = boot_now_us();
+
+    for (uint8_t i = 0; i < stages_n; i++)
+    {
+        if ((!(done & BOOT_DEP(i)) || (failed & BOOT_DEP(i))) && stages[i].fatal)
+        {
+            ret = -1;
+        }
+    }
+
+    boot_report();
+
+    return ret;
+}
+
+/**
+ * @brief boot_mark_audio; first processed audio block, only the first call is recorded
+ *
+ */
+void boot_mark_audio(void)
+{
+    if (atomic_cas(&boot_handler.audio_marked, 0, 1))
+    {
+        boot_handler.audio_us = boot_now_us();
+    }
+}
+
+/**
+ * @brief boot_get_stats
+ *
+ * @param stage
+ * @param stats
+ * @return int
+ */
+int boot_get_stats(uint8_t stage, struct boot_stage_stats *stats)
+{
+    if (stage >= boot_handler.stages_n)
+    {
+        return -1;
+    }
+
+    *stats = boot_handler.stats[stage];
+
+    return 0;
+}
+
+/**
+ * @brief boot_get_done_us
+ *
+ * @return uint32_t
+ */
+uint32_t boot_get_done_us(void)
+{
+    return boot_handler.done_us;
+}
+
+/**
+ * @brief boot_get_audio_us
+ *
+ * @return uint32_t 0 until the first audio block
+ */
+uint32_t boot_get_audio_us(void)
+{
+    return boot_handler.audio_us;
+}
+
+/**
+ * @brief boot_worker
+ *
+ * @param a
+ * @param b
+ * @param c
+ */
+static void boot_worker(void *a, void *b, void *c)
+{
+    uint8_t id;
+
+    while (1)
+    {
+        k_msgq_get(&boot_ready_msgq, &id, K_FOREVER);
+        if (id == BOOT_WORKER_EXIT)
+        {
+            return;
+        }
+
+        struct boot_stage_stats *stats = &boot_handler.stats[id];
+
+        stats->start_us = boot_now_us();
+        stats->result = boot_handler.stages[id].init();
+        stats->end_us = boot_now_us();
+        stats->run = true;
+
+        k_msgq_put(&boot_done_msgq, &id, K_FOREVER);
+    }
+}
+
+/**
+ * @brief boot_now_us
+ *
+ * @return uint32_t
+ */
+static uint32_t boot_now_us(void)
+{
+    return (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/**
+ * @brief boot_report
+ *
+ */
+static void boot_report(void)
+{
+    for (uint8_t i = 0; i < boot_handler.stages_n; i++)
+    {
+        struct boot_stage_stats *stats = &boot_handler.stats[i];
+
+        if (!stats->run)
+        {
+            printk("Boot %s: skipped\n", boot_handler.stages[i].name);
+            continue;
+        }
+        printk("Boot %s: %u -> %u us (%u us)%s\n", boot_handler.stages[i].name, stats->start_us, stats->end_us,
+               (stats->end_us - stats->start_us), ((stats->result < 0) ? " failed" : ""));
+    }
+    printk("Boot done: %u us\n", boot_handler.done_us);
+}
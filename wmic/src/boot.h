@@ -0,0 +1,34 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BOOT_MAX_STAGES 8
+#define BOOT_DEP(stage) (1U << (stage))
+
+typedef int (*boot_init_fn)(void);
+
+struct boot_stage
+{
+    const char *name;
+    boot_init_fn init;
+    uint32_t deps; // BOOT_DEP() mask of the stages to wait for
+    bool fatal;    // A failure stops the boot
+};
+
+struct boot_stage_stats
+{
+    int result;
+    bool run;          // False if skipped because a dependency failed
+    uint32_t start_us; // From power-on
+    uint32_t end_us;
+};
+
+int boot_run(const struct boot_stage *stages, uint8_t stages_n);
+void boot_mark_audio(void);
+int boot_get_stats(uint8_t stage, struct boot_stage_stats *stats);
+uint32_t boot_get_done_us(void);
+uint32_t boot_get_audio_us(void);
+
+#endif // BOOT_H
@@ -7,7 +7,9 @@
 #define ENABLE_DSP_ADT_EFFECT true
 #define ENABLE_STEREO_DIFF true
 #define ENABLE_SIGNAL_GEN false
-#define ENABLE_INPUTS_INT false
+#define ENABLE_INPUTS_INT true // PCF8574 INT wired on keypad_int (board overlay), set false if not wired: the keypad is then polled every KEYPAD_DRV_POLL_MS
+#define ENABLE_LATENCY_MEAS false // BUTTON_5 plays a MLS burst on the live output, needs the loopback cable
+#define ENABLE_DITHER true
 
 // Display defines
 #define DISPLAY_STB_TIME_MS 10000
@@ -16,3 +18,22 @@
 #define AMP_FACTOR 3 // NOTE; I2S data are 32 bit in size, only 24 lower bit are valid, but bt module considers only 16 higher bit in a 32 bit data
 #define MAX_LIMIT (INT32_MAX / (pow(2, AMP_FACTOR)))
 #define MIN_LIMIT (INT32_MIN / (pow(2, AMP_FACTOR)))
+
+// Signal generator defines
+#define SIG_GEN_WAVE SIG_WAVE_SINE
+#define SIG_GEN_FREQ 1000.0f // Hz
+#define SIG_GEN_AMP 0.55f    // 0.0 to 1.0
+
+// ADT defines
+#define ADT_DELAY_DEF_MS 500  // Delay after reset
+#define ADT_DELAY_MIN_MS 10
+#define ADT_DELAY_MAX_MS 1000 // Delay line holds ~1.1 s at 44.1 kHz
+
+// Balanced input defines
+#define BALANCED_CAL_MS 1000 // Start-up window used to match the legs gain, keep the mic at rest
+
+// Dither defines
+#define DITHER_SHAPER DITHER_SHAPER_2ND // DITHER_SHAPER_NONE, DITHER_SHAPER_1ST or DITHER_SHAPER_2ND
+
+// Profiling defines
+#define DSP_PROF_REPORT_MS 5000 // Period of the DSP cycles report
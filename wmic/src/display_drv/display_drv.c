@@ -12,18 +12,41 @@
 #include <zephyr/devicetree.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/display.h>
-#include <zephyr/display/cfb.h>
 #include <zephyr/sys/printk.h>
+#include <zephyr/timing/timing.h>
 
 #include <stdio.h>
+#include <string.h>
 
+#include "display_fb.h"
 #include "my_fonts.h"
 
 #define DISPLAY_DRV_THREAD_STACK (4096)
 #define DISPLAY_DRV_THREAD_PRIORITY 8
+#define DISPLAY_DRV_QUEUE_LEN 8
+#define DISPLAY_DRV_PAGES_N (DISPLAY_DRV_QUEUE_LEN + 3) // Queued, pending and being filled by the callers
+#define DISPLAY_DRV_FRAME_MS (1000 / DISPLAY_DRV_MAX_FPS)
+#define DISPLAY_DRV_AVG_SHIFT 4 // Render time moving average weight (1/16)
+
+// Page layout, rows are page aligned so glyphs are copied as they are
+#define DISPLAY_DRV_TITLE_X 40
+#define DISPLAY_DRV_PAR_PAGE 2 // par[0] and par[2], par[1] and par[3] on the next page
+#define DISPLAY_DRV_BAR_PAGE 5
+#define DISPLAY_DRV_METER_PAGE 6
+#define DISPLAY_DRV_WIDGET_X 8
+#define DISPLAY_DRV_WIDGET_W 112
 
 K_THREAD_STACK_DEFINE(display_drv_stack, DISPLAY_DRV_THREAD_STACK);
-K_SEM_DEFINE(display_drv_event_sem, 0, 1);
+
+// Display updates, pages are passed by handle
+struct display_drv_msg
+{
+    display_event_t event;
+    display_pages_t *page; // SHOW_PAGE, slab block released by the display thread
+    char str[DISPLAY_DRV_STR_SIZE];
+};
+K_MSGQ_DEFINE(display_drv_msgq, sizeof(struct display_drv_msg), DISPLAY_DRV_QUEUE_LEN, 4);
+K_MEM_SLAB_DEFINE(display_drv_page_slab, sizeof(display_pages_t), DISPLAY_DRV_PAGES_N, 4);
 
 // Display data structures
 struct display_drv_handler_t
@@ -32,11 +55,13 @@ struct display_drv_handler_t
     struct display_capabilities capabilities;
     uint8_t font_width;
     uint8_t font_height;
-    char dis_str[100];
-    display_pages_t page;
+    struct display_drv_msg pending; // Latest update, rendered at the next frame
+    bool pending_valid;
+    int64_t frame_ms; // Uptime of the last frame
     display_state_t display_state;
+    struct display_drv_render_stats render; // display_drv_show_page, written by the display thread only
+    uint32_t reported;                      // Pages rendered at the last report
 } static display_drv_handler;
-static display_event_t display_drv_event;
 static int my_font_idx = 0;
 
 static struct k_thread display_drv_tcb;
@@ -44,8 +69,10 @@ static struct k_thread display_drv_tcb;
 static void display_drv_thread(void *a, void *b, void *c);
 
 static void display_drv_process(void);
-static void display_drv_show_str(void);
-static void display_drv_show_page(void);
+static void display_drv_coalesce(const struct display_drv_msg *msg);
+static void display_drv_show_str(const char *str);
+static void display_drv_show_page(const display_pages_t *page);
+static void display_drv_render_account(timing_t *start);
 
 /**
  * @brief display_drv_config
@@ -61,6 +88,10 @@ int display_drv_config(void)
         return -1;
     }
 
+    // Page render timing
+    timing_init();
+    timing_start();
+
     k_thread_create(&display_drv_tcb,
                     display_drv_stack,
                     DISPLAY_DRV_THREAD_STACK,
@@ -72,13 +103,86 @@ int display_drv_config(void)
 }
 
 /**
- * @brief display_drv_strToShow
+ * @brief display_drv_str_show; centered string
  *
  * @param str
+ * @return int
+ */
+int display_drv_str_show(const char *str)
+{
+    struct display_drv_msg msg = {.event = SHOW_STRING};
+
+    strncpy(msg.str, str, (sizeof(msg.str) - 1));
+
+    return k_msgq_put(&display_drv_msgq, &msg, K_NO_WAIT);
+}
+
+/**
+ * @brief display_drv_page_alloc; page to fill in place and pass to display_drv_page_show
+ *
+ * @return display_pages_t* NULL if every page is in use
+ */
+display_pages_t *display_drv_page_alloc(void)
+{
+    display_pages_t *page;
+
+    if (k_mem_slab_alloc(&display_drv_page_slab, (void **)&page, K_NO_WAIT) != 0)
+    {
+        return NULL;
+    }
+
+    // Blank page, widgets hidden
+    memset(page, 0, sizeof(display_pages_t));
+    page->bar = -1;
+    page->meter = -1;
+
+    return page;
+}
+
+/**
+ * @brief display_drv_page_show; the page handle is owned by the display driver afterwards
+ *
+ * @param page
+ * @return int
+ */
+int display_drv_page_show(display_pages_t *page)
+{
+    struct display_drv_msg msg = {.event = SHOW_PAGE, .page = page};
+
+    if (k_msgq_put(&display_drv_msgq, &msg, K_NO_WAIT) != 0)
+    {
+        k_mem_slab_free(&display_drv_page_slab, page);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief display_drv_get_render_stats
+ *
+ * @param stats
+ */
+void display_drv_get_render_stats(struct display_drv_render_stats *stats)
+{
+    *stats = display_drv_handler.render;
+}
+
+/**
+ * @brief display_drv_report; page render cost, printed only if pages were rendered since the last one
+ *
  */
-void display_drv_strToShow(const char *str)
+void display_drv_report(void)
 {
-    strcpy(display_drv_handler.dis_str, str);
+    struct display_drv_render_stats s = display_drv_handler.render;
+
+    if (s.count == display_drv_handler.reported)
+    {
+        return;
+    }
+    display_drv_handler.reported = s.count;
+
+    printk("Display page: avg %u us, max %u us, pages %u\n", s.avg_us, s.max_us, s.count);
 }
 
 /**
@@ -108,8 +212,9 @@ void display_drv_turn_off(void)
  */
 void display_drv_event_set(display_event_t event)
 {
-    display_drv_event = event;
-    k_sem_give(&display_drv_event_sem);
+    struct display_drv_msg msg = {.event = event};
+
+    k_msgq_put(&display_drv_msgq, &msg, K_NO_WAIT);
 }
 
 /**
@@ -122,23 +227,6 @@ display_state_t display_drv_get_status(void)
     return display_drv_handler.display_state;
 }
 
-/**
- * @brief display_drv_pageToShow
- *
- * @param page
- */
-void display_drv_pageToShow(display_pages_t page)
-{
-    strcpy(display_drv_handler.page.title, page.title);
-    display_drv_handler.page.par_select = page.par_select;
-    display_drv_handler.page.EnDis = page.EnDis;
-    for (int i = 0; i < 4; i++)
-    {
-        strcpy(display_drv_handler.page.par[i].title, page.par[i].title);
-        strcpy(display_drv_handler.page.par[i].val, page.par[i].val);
-    }
-}
-
 /**
  * @brief display_drv_thread
  *
@@ -154,20 +242,17 @@ static void display_drv_thread(void *a, void *b, void *c)
            display_drv_handler.capabilities.x_resolution,
            display_drv_handler.capabilities.y_resolution);
 
-    // Init CFB (Control Frame Buffer)
-    if (cfb_framebuffer_init(display_drv_handler.display))
+    // Init the frame buffer, drawn locally and sent by changed regions
+    if (display_fb_init(display_drv_handler.display))
     {
-        printf("CFB init failed\n");
+        printf("Frame buffer init failed\n");
     }
 
     // Get my font index
-    my_font_idx = cfb_get_numof_fonts(display_drv_handler.display) - 1;
-
-    // Set font 0
-    cfb_framebuffer_set_font(display_drv_handler.display, 0);
+    my_font_idx = display_fb_fonts_num() - 1;
 
     // Read font sizes
-    cfb_get_font_size(display_drv_handler.display, 0, &display_drv_handler.font_width, &display_drv_handler.font_height);
+    display_fb_font_size(0, &display_drv_handler.font_width, &display_drv_handler.font_height);
 
     // Turn of the display
     display_drv_turn_off();
@@ -179,14 +264,33 @@ static void display_drv_thread(void *a, void *b, void *c)
 }
 
 /**
- * @brief display_drv_process
+ * @brief display_drv_process; one frame at most every DISPLAY_DRV_FRAME_MS, with the latest update
  *
  */
 static void display_drv_process(void)
 {
-    k_sem_take(&display_drv_event_sem, K_FOREVER);
+    struct display_drv_msg msg;
+    int64_t wait;
+
+    k_msgq_get(&display_drv_msgq, &msg, K_FOREVER);
+    display_drv_coalesce(&msg);
+
+    // Frame rate cap, updates arriving meanwhile replace the pending one
+    while ((wait = (display_drv_handler.frame_ms + DISPLAY_DRV_FRAME_MS - k_uptime_get())) > 0)
+    {
+        if (k_msgq_get(&display_drv_msgq, &msg, K_MSEC(wait)) == 0)
+        {
+            display_drv_coalesce(&msg);
+        }
+    }
+    while (k_msgq_get(&display_drv_msgq, &msg, K_NO_WAIT) == 0)
+    {
+        display_drv_coalesce(&msg);
+    }
+
+    struct display_drv_msg *pending = &display_drv_handler.pending;
 
-    switch (display_drv_event)
+    switch (pending->event)
     {
     case EV1:
         break;
@@ -197,112 +301,151 @@ static void display_drv_process(void)
     case EV4:
         break;
     case SHOW_STRING:
-        display_drv_show_str();
+        display_drv_show_str(pending->str);
         break;
     case SHOW_PAGE:
-        display_drv_show_page();
+    {
+        timing_t start = timing_counter_get();
+
+        display_drv_show_page(pending->page);
+        display_drv_render_account(&start);
         break;
+    }
     default:
         break;
     }
 
+    if (pending->page != NULL)
+    {
+        k_mem_slab_free(&display_drv_page_slab, pending->page);
+        pending->page = NULL;
+    }
+    display_drv_handler.pending_valid = false;
+    display_drv_handler.frame_ms = k_uptime_get();
+
     display_drv_turn_on();
 }
 
+/**
+ * @brief display_drv_render_account; page render and transfer time
+ *
+ * @param start
+ */
+static void display_drv_render_account(timing_t *start)
+{
+    timing_t end = timing_counter_get();
+    struct display_drv_render_stats *s = &display_drv_handler.render;
+    uint32_t us = (uint32_t)(timing_cycles_to_ns(timing_cycles_get(start, &end)) / 1000);
+
+    s->last_us = us;
+    s->max_us = MAX(s->max_us, us);
+    if (s->count == 0)
+    {
+        s->avg_us = us;
+    }
+    else
+    {
+        s->avg_us = (uint32_t)((int32_t)s->avg_us + (((int32_t)us - (int32_t)s->avg_us) >> DISPLAY_DRV_AVG_SHIFT));
+    }
+    s->count++;
+}
+
+/**
+ * @brief display_drv_coalesce; keep only the latest screen content
+ *
+ * @param msg
+ */
+static void display_drv_coalesce(const struct display_drv_msg *msg)
+{
+    struct display_drv_msg *pending = &display_drv_handler.pending;
+
+    if (display_drv_handler.pending_valid && (msg->event != SHOW_STRING) && (msg->event != SHOW_PAGE))
+    {
+        return; // No content, the pending frame turns the display on anyway
+    }
+
+    if (pending->page != NULL)
+    {
+        k_mem_slab_free(&display_drv_page_slab, pending->page);
+    }
+    *pending = *msg;
+    display_drv_handler.pending_valid = true;
+}
+
 /**
  * @brief display_drv_show_str
  *
+ * @param str
  */
-static void display_drv_show_str(void)
+static void display_drv_show_str(const char *str)
 {
-    cfb_framebuffer_clear(display_drv_handler.display, true);
+    display_fb_clear();
 
-    size_t len = strlen(display_drv_handler.dis_str);
+    size_t len = strlen(str);
 
     uint16_t text_width = len * display_drv_handler.font_width;
     uint16_t x = (display_drv_handler.capabilities.x_resolution - text_width) / 2;
     uint16_t y = 40;
 
-    cfb_print(display_drv_handler.display, display_drv_handler.dis_str, x, y);
+    display_fb_print(str, x, y, 0);
 
     // Display update
-    cfb_framebuffer_finalize(display_drv_handler.display);
+    display_fb_flush();
 }
 
 /**
  * @brief display_drv_show_page
  *
+ * @param page
  */
-static void display_drv_show_page(void)
+static void display_drv_show_page(const display_pages_t *page)
 {
-    struct cfb_position p1 = {.x = 3, .y = 16};
-    struct cfb_position p2 = {.x = 7, .y = 19};
+    static const uint8_t par_x[4] = {10, 10, 75, 75};
+    static const uint8_t val_x[4] = {45, 45, 110, 110};
+
+    display_fb_clear();
 
-    if (display_drv_handler.page.par_select == 1)
+    uint16_t title_end = display_fb_print(page->title, DISPLAY_DRV_TITLE_X, 0, 0);
+
+    if (page->EnDis == 0)
     {
-        p1.x = 3;
-        p1.y = 16;
-        p2.x = 7;
-        p2.y = 19;
+        display_fb_print("OFF", 100, 0, my_font_idx);
     }
-    else if (display_drv_handler.page.par_select == 2)
+    else
     {
-        p1.x = 3;
-        p1.y = 25;
-        p2.x = 7;
-        p2.y = 28;
+        display_fb_print("ON", 110, 0, my_font_idx);
     }
-    else if (display_drv_handler.page.par_select == 3)
+
+    for (uint8_t i = 0; i < 4; i++)
     {
-        p1.x = 67;
-        p1.y = 16;
-        p2.x = 71;
-        p2.y = 19;
+        uint16_t y = ((DISPLAY_DRV_PAR_PAGE + (i % 2)) * DISPLAY_FB_PAGE_ROWS);
+
+        display_fb_print(page->par[i].title, par_x[i], y, my_font_idx);
+        display_fb_print(page->par[i].val, val_x[i], y, my_font_idx);
     }
-    else if (display_drv_handler.page.par_select == 4)
+
+    if (page->bar >= 0)
     {
-        p1.x = 67;
-        p1.y = 25;
-        p2.x = 71;
-        p2.y = 28;
+        display_fb_bar(DISPLAY_DRV_WIDGET_X, DISPLAY_DRV_BAR_PAGE, DISPLAY_DRV_WIDGET_W, page->bar);
     }
-    else
+    if (page->meter >= 0)
     {
-        // Title
-        p1.x = 34;
-        p1.y = 5;
-        p2.x = 38;
-        p2.y = 9;
+        display_fb_meter(DISPLAY_DRV_WIDGET_X, DISPLAY_DRV_METER_PAGE, DISPLAY_DRV_WIDGET_W, page->meter);
     }
 
-    cfb_framebuffer_clear(display_drv_handler.display, true);
-
-    cfb_framebuffer_set_font(display_drv_handler.display, 0);
-    cfb_print(display_drv_handler.display, display_drv_handler.page.title, 40, 0);
-    cfb_framebuffer_finalize(display_drv_handler.display);
-
-    cfb_framebuffer_set_font(display_drv_handler.display, my_font_idx);
-
-    cfb_draw_rect(display_drv_handler.display, &p1, &p2);
-
-    if (display_drv_handler.page.EnDis == 0)
+    // Selection box, parameters are numbered from 1, 0 selects the title
+    if ((page->par_select >= 1) && (page->par_select <= 4))
     {
-        cfb_print(display_drv_handler.display, "OFF", 100, 3);
+        uint8_t i = (page->par_select - 1);
+        uint8_t row = (DISPLAY_DRV_PAR_PAGE + (i % 2));
+
+        display_fb_invert((par_x[i] - 2), ((i < 2) ? (par_x[2] - 3) : (DISPLAY_FB_WIDTH - 1)), row, row);
     }
     else
     {
-        cfb_print(display_drv_handler.display, "ON", 110, 3);
+        display_fb_invert((DISPLAY_DRV_TITLE_X - 2), title_end, 0, ((display_drv_handler.font_height / DISPLAY_FB_PAGE_ROWS) - 1));
     }
 
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[0].title, 10, 15);
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[1].title, 10, 24);
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[2].title, 75, 15);
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[3].title, 75, 24);
-
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[0].val, 45, 15);
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[1].val, 45, 24);
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[2].val, 110, 15);
-    cfb_print(display_drv_handler.display, display_drv_handler.page.par[3].val, 110, 24);
-
-    cfb_framebuffer_finalize(display_drv_handler.display);
-}
\ No newline at end of file
+    // Single update, only the changed regions are sent
+    display_fb_flush();
+}
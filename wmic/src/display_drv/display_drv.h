@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 
+#define DISPLAY_DRV_MAX_FPS 20 // Refresh cap, newer updates replace the pending one
+#define DISPLAY_DRV_STR_SIZE 40
+
 typedef enum
 {
     EV1,
@@ -32,14 +35,27 @@ typedef struct
     uint8_t EnDis;
     page_data_par_t par[4]; 
     uint8_t par_select;
+    int8_t bar;   // Bar widget fill, 0 to 100, -1 hidden
+    int8_t meter; // Meter widget level, 0 to 100, -1 hidden
 } display_pages_t;
 
+struct display_drv_render_stats
+{
+    uint32_t last_us; // Render and transfer of the last page
+    uint32_t max_us;  // Worst case
+    uint32_t avg_us;  // Moving average
+    uint32_t count;   // Number of rendered pages
+};
+
 int display_drv_config(void);
-void display_drv_strToShow(const char *str);
+int display_drv_str_show(const char *str);
 void display_drv_turn_on(void);
 void display_drv_turn_off(void);
 void display_drv_event_set(display_event_t event);
 display_state_t display_drv_get_status(void);
-void display_drv_pageToShow(display_pages_t page);
+display_pages_t *display_drv_page_alloc(void);
+int display_drv_page_show(display_pages_t *page);
+void display_drv_get_render_stats(struct display_drv_render_stats *stats);
+void display_drv_report(void);
 
 #endif // DISPLAY_DRV_H
\ No newline at end of file
@@ -0,0 +1,560 @@
+/*
+ * Display frame buffer
+ * OLED Controller: SSD1306, page (8 rows) organized RAM
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "display_fb.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/display.h>
+#include <zephyr/display/cfb.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/printk.h>
+
+#include <string.h>
+
+#define DISPLAY_FB_MAX_FONTS 6
+#define DISPLAY_FB_ATLAS_SIZE 2048 // Room for the repacked multi page fonts
+
+// Glyphs ready to blit, each glyph page row is a run of width bytes (LSB on top)
+struct display_fb_atlas
+{
+    const uint8_t *glyphs; // NULL if the font can't be used
+    uint16_t glyph_size;   // width * rows
+    uint8_t width;
+    uint8_t rows; // Pages per glyph
+    uint8_t first_char;
+    uint8_t last_char;
+};
+
+// Frame buffer data structures
+struct display_fb_handler_t
+{
+    const struct device *display;
+    uint8_t buf[DISPLAY_FB_PAGES][DISPLAY_FB_WIDTH];   // Frame being drawn
+    uint8_t shown[DISPLAY_FB_PAGES][DISPLAY_FB_WIDTH]; // Panel RAM content
+    uint8_t dirty_x0[DISPLAY_FB_PAGES];                // Changed columns of each page, clean if x0 > x1
+    uint8_t dirty_x1[DISPLAY_FB_PAGES];
+    bool synced;   // shown[] matches the panel RAM
+    bool inverted; // Bits sent complemented, as cfb_framebuffer_finalize() does on MONO10 panels
+    struct display_fb_atlas atlas[DISPLAY_FB_MAX_FONTS];
+    uint8_t fonts_num;
+} static display_fb_handler;
+
+static uint8_t display_fb_atlas_pool[DISPLAY_FB_ATLAS_SIZE];
+
+static void display_fb_atlas_build(void);
+static void display_fb_put(uint8_t page, uint16_t x, uint8_t bits, uint8_t mask);
+static void display_fb_run(uint8_t page, uint16_t x, const uint8_t *src, uint16_t len);
+static void display_fb_pixel(uint16_t x, uint16_t y);
+static void display_fb_clean(uint8_t page);
+static inline uint8_t display_fb_reverse(uint8_t b);
+
+/**
+ * @brief display_fb_init
+ *
+ * @param display
+ * @return int
+ */
+int display_fb_init(const struct device *display)
+{
+    struct display_capabilities caps;
+
+    display_get_capabilities(display, &caps);
+    if ((caps.x_resolution != DISPLAY_FB_WIDTH) || (caps.y_resolution != DISPLAY_FB_HEIGHT) ||
+        !(caps.screen_info & SCREEN_INFO_MONO_VTILED))
+    {
+        return -1;
+    }
+
+    display_fb_handler.display = display;
+    // Same rule as CFB with its inversion off (never turned on by this app): complement on MONO10
+    display_fb_handler.inverted = (caps.current_pixel_format == PIXEL_FORMAT_MONO10);
+    display_fb_handler.synced = false;
+    memset(display_fb_handler.buf, 0, sizeof(display_fb_handler.buf));
+    for (uint8_t p = 0; p < DISPLAY_FB_PAGES; p++)
+    {
+        display_fb_clean(p);
+    }
+
+    display_fb_atlas_build();
+
+    return 0;
+}
+
+/**
+ * @brief display_fb_clear; only the columns actually changed by the next frame are sent
+ *
+ */
+void display_fb_clear(void)
+{
+    for (uint8_t p = 0; p < DISPLAY_FB_PAGES; p++)
+    {
+        for (uint16_t x = 0; x < DISPLAY_FB_WIDTH; x++)
+        {
+            display_fb_put(p, x, 0x00, 0xFF);
+        }
+    }
+}
+
+/**
+ * @brief display_fb_fonts_num
+ *
+ * @return uint8_t
+ */
+uint8_t display_fb_fonts_num(void)
+{
+    return display_fb_handler.fonts_num;
+}
+
+/**
+ * @brief display_fb_font_size
+ *
+ * @param font_idx
+ * @param width
+ * @param height
+ * @return int
+ */
+int display_fb_font_size(uint8_t font_idx, uint8_t *width, uint8_t *height)
+{
+    const struct display_fb_atlas *atlas = &display_fb_handler.atlas[font_idx];
+
+    if ((font_idx >= display_fb_handler.fonts_num) || (atlas->glyphs == NULL))
+    {
+        return -1;
+    }
+
+    *width = atlas->width;
+    *height = (atlas->rows * DISPLAY_FB_PAGE_ROWS);
+
+    return 0;
+}
+
+/**
+ * @brief display_fb_print; glyphs overwrite their whole cell, page aligned rows are copied as they are
+ *
+ * @param str
+ * @param x
+ * @param y
+ * @param font_idx
+ * @return uint16_t x after the last glyph
+ */
+uint16_t display_fb_print(const char *str, uint16_t x, uint16_t y, uint8_t font_idx)
+{
+    const struct display_fb_atlas *atlas = &display_fb_handler.atlas[font_idx];
+
+    if ((font_idx >= display_fb_handler.fonts_num) || (atlas->glyphs == NULL))
+    {
+        return x;
+    }
+
+    uint8_t shift = (y % DISPLAY_FB_PAGE_ROWS);
+    uint8_t page = (y / DISPLAY_FB_PAGE_ROWS);
+
+    for (; (*str != '\0') && (x < DISPLAY_FB_WIDTH); str++)
+    {
+        uint8_t c = (uint8_t)*str;
+
+        if ((c < atlas->first_char) || (c > atlas->last_char))
+        {
+            c = ' ';
+        }
+
+        const uint8_t *glyph = &atlas->glyphs[(c - atlas->first_char) * atlas->glyph_size];
+        uint16_t len = MIN(atlas->width, (DISPLAY_FB_WIDTH - x));
+
+        for (uint8_t r = 0; r < atlas->rows; r++)
+        {
+            const uint8_t *run = &glyph[r * atlas->width];
+
+            if (shift == 0)
+            {
+                if ((page + r) < DISPLAY_FB_PAGES)
+                {
+                    display_fb_run((page + r), x, run, len);
+                }
+                continue;
+            }
+
+            // A misaligned glyph row spans two pages
+            for (uint16_t col = 0; col < len; col++)
+            {
+                if ((page + r) < DISPLAY_FB_PAGES)
+                {
+                    display_fb_put((page + r), (x + col), (run[col] << shift), (0xFF << shift));
+                }
+                if ((page + r + 1) < DISPLAY_FB_PAGES)
+                {
+                    display_fb_put((page + r + 1), (x + col), (run[col] >> (8 - shift)), (0xFF >> (8 - shift)));
+                }
+            }
+        }
+        x += len;
+    }
+
+    return x;
+}
+
+/**
+ * @brief display_fb_bar; framed horizontal bar, one page high
+ *
+ * @param x
+ * @param page
+ * @param width
+ * @param percent
+ */
+void display_fb_bar(uint16_t x, uint8_t page, uint16_t width, uint8_t percent)
+{
+    if ((page >= DISPLAY_FB_PAGES) || (width < 3))
+    {
+        return;
+    }
+
+    width = MIN(width, (DISPLAY_FB_WIDTH - x));
+    uint16_t fill = (((width - 2) * MIN(percent, 100)) / 100);
+
+    for (uint16_t i = 0; i < width; i++)
+    {
+        uint8_t col;
+
+        if ((i == 0) || (i == (width - 1)))
+        {
+            col = 0x7E; // Frame sides
+        }
+        else
+        {
+            col = (i <= fill) ? 0x7E : 0x42; // Filled or frame top and bottom only
+        }
+        display_fb_put(page, (x + i), col, 0xFF);
+    }
+}
+
+/**
+ * @brief display_fb_meter; segmented level meter with a tick every 4 segments, one page high
+ *
+ * @param x
+ * @param page
+ * @param width
+ * @param percent
+ */
+void display_fb_meter(uint16_t x, uint8_t page, uint16_t width, uint8_t percent)
+{
+    if (page >= DISPLAY_FB_PAGES)
+    {
+        return;
+    }
+
+    width = MIN(width, (DISPLAY_FB_WIDTH - x));
+    uint16_t segs = ((width + 1) / 4); // 3 columns segment and 1 column gap
+    uint16_t lit = (((segs * MIN(percent, 100)) + 50) / 100);
+
+    for (uint16_t i = 0; i < width; i++)
+    {
+        uint16_t seg = (i / 4);
+        uint8_t col;
+
+        if ((i % 4) == 3)
+        {
+            col = ((seg % 4) == 3) ? 0x80 : 0x00; // Gap, scale tick at the bottom
+        }
+        else
+        {
+            col = (seg < lit) ? 0x3E : 0x20; // Lit segment or baseline
+        }
+        display_fb_put(page, (x + i), col, 0xFF);
+    }
+}
+
+/**
+ * @brief display_fb_invert; selection box, page aligned
+ *
+ * @param x0
+ * @param x1
+ * @param page0
+ * @param page1
+ */
+void display_fb_invert(uint16_t x0, uint16_t x1, uint8_t page0, uint8_t page1)
+{
+    x1 = MIN(x1, (DISPLAY_FB_WIDTH - 1));
+    page1 = MIN(page1, (DISPLAY_FB_PAGES - 1));
+
+    for (uint8_t p = page0; p <= page1; p++)
+    {
+        for (uint16_t x = x0; x <= x1; x++)
+        {
+            display_fb_put(p, x, ~display_fb_handler.buf[p][x], 0xFF);
+        }
+    }
+}
+
+/**
+ * @brief display_fb_rect; outline, corners included
+ *
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ */
+void display_fb_rect(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    for (uint16_t x = x0; x <= x1; x++)
+    {
+        display_fb_pixel(x, y0);
+        display_fb_pixel(x, y1);
+    }
+    for (uint16_t y = y0; y <= y1; y++)
+    {
+        display_fb_pixel(x0, y);
+        display_fb_pixel(x1, y);
+    }
+}
+
+/**
+ * @brief display_fb_flush; write the changed columns of each dirty page
+ *
+ * @return int bytes sent to the panel, -1 on bus error
+ */
+int display_fb_flush(void)
+{
+    uint8_t tx[DISPLAY_FB_WIDTH];
+    int sent = 0;
+
+    for (uint8_t p = 0; p < DISPLAY_FB_PAGES; p++)
+    {
+        uint16_t x0 = display_fb_handler.dirty_x0[p];
+        uint16_t x1 = display_fb_handler.dirty_x1[p];
+        const uint8_t *buf = display_fb_handler.buf[p];
+        const uint8_t *shown = display_fb_handler.shown[p];
+
+        if (!display_fb_handler.synced)
+        {
+            // Panel RAM unknown, whole page
+            x0 = 0;
+            x1 = (DISPLAY_FB_WIDTH - 1);
+        }
+        else
+        {
+            // Columns drawn again with the same content are not sent
+            while ((x0 <= x1) && (buf[x0] == shown[x0]))
+            {
+                x0++;
+            }
+            while ((x1 > x0) && (buf[x1] == shown[x1]))
+            {
+                x1--;
+            }
+            if (x0 > x1)
+            {
+                display_fb_clean(p);
+                continue;
+            }
+        }
+
+        uint16_t len = (x1 - x0 + 1);
+        struct display_buffer_descriptor desc = {
+            .buf_size = len,
+            .width = len,
+            .height = DISPLAY_FB_PAGE_ROWS,
+            .pitch = len,
+        };
+
+        for (uint16_t i = 0; i < len; i++)
+        {
+            tx[i] = display_fb_handler.inverted ? (uint8_t)~buf[x0 + i] : buf[x0 + i];
+        }
+
+        if (display_write(display_fb_handler.display, x0, (p * DISPLAY_FB_PAGE_ROWS), &desc, tx) != 0)
+        {
+            return -1; // Region stays dirty, sent again on the next flush
+        }
+
+        memcpy(&display_fb_handler.shown[p][x0], &buf[x0], len);
+        display_fb_clean(p);
+        sent += len;
+    }
+
+    display_fb_handler.synced = true;
+
+    return sent;
+}
+
+/**
+ * @brief display_fb_atlas_build; CFB fonts repacked as page row runs, LSB on top
+ *
+ * Single page fonts are already laid out this way and are used in place.
+ */
+static void display_fb_atlas_build(void)
+{
+    uint16_t used = 0;
+    int num;
+
+    STRUCT_SECTION_COUNT(cfb_font, &num);
+    display_fb_handler.fonts_num = MIN(num, DISPLAY_FB_MAX_FONTS);
+
+    for (uint8_t f = 0; f < display_fb_handler.fonts_num; f++)
+    {
+        struct display_fb_atlas *atlas = &display_fb_handler.atlas[f];
+        const struct cfb_font *font;
+
+        STRUCT_SECTION_GET(cfb_font, f, &font);
+
+        atlas->glyphs = NULL;
+        atlas->width = font->width;
+        atlas->rows = (font->height / DISPLAY_FB_PAGE_ROWS);
+        atlas->glyph_size = (atlas->width * atlas->rows);
+        atlas->first_char = font->first_char;
+        atlas->last_char = font->last_char;
+
+        if (!(font->caps & CFB_FONT_MONO_VPACKED))
+        {
+            continue; // SSD1306 pages are vertically packed
+        }
+
+        const uint8_t *data = font->data;
+        uint16_t size = (atlas->glyph_size * (atlas->last_char - atlas->first_char + 1));
+
+        if ((atlas->rows == 1) && !(font->caps & CFB_FONT_MSB_FIRST))
+        {
+            atlas->glyphs = data;
+            continue;
+        }
+
+        if ((used + size) > DISPLAY_FB_ATLAS_SIZE)
+        {
+            // No room, text in this font is not drawn: raise DISPLAY_FB_ATLAS_SIZE
+            printk("Display font %u (%ux%u) needs %u atlas bytes, %u left\n", f, font->width, font->height, size,
+                   (DISPLAY_FB_ATLAS_SIZE - used));
+            continue;
+        }
+
+        // CFB glyphs are column major, interleave the page rows out
+        uint8_t *dst = &display_fb_atlas_pool[used];
+        for (uint16_t g = 0; g < (size / atlas->glyph_size); g++)
+        {
+            const uint8_t *src = &data[g * atlas->glyph_size];
+            uint8_t *out = &dst[g * atlas->glyph_size];
+
+            for (uint8_t col = 0; col < atlas->width; col++)
+            {
+                for (uint8_t r = 0; r < atlas->rows; r++)
+                {
+                    uint8_t bits = src[(col * atlas->rows) + r];
+
+                    out[(r * atlas->width) + col] = (font->caps & CFB_FONT_MSB_FIRST) ? display_fb_reverse(bits) : bits;
+                }
+            }
+        }
+        atlas->glyphs = dst;
+        used += size;
+    }
+}
+
+/**
+ * @brief display_fb_run; copy a run of columns into a page
+ *
+ * @param page
+ * @param x
+ * @param src
+ * @param len
+ */
+static void display_fb_run(uint8_t page, uint16_t x, const uint8_t *src, uint16_t len)
+{
+    uint8_t *dst = &display_fb_handler.buf[page][x];
+    int16_t first = -1;
+    int16_t last = -1;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (dst[i] != src[i])
+        {
+            dst[i] = src[i];
+            first = (first < 0) ? i : first;
+            last = i;
+        }
+    }
+
+    if (first < 0)
+    {
+        return;
+    }
+    if ((x + first) < display_fb_handler.dirty_x0[page])
+    {
+        display_fb_handler.dirty_x0[page] = (x + first);
+    }
+    if ((x + last) > display_fb_handler.dirty_x1[page])
+    {
+        display_fb_handler.dirty_x1[page] = (x + last);
+    }
+}
+
+/**
+ * @brief display_fb_put; update the masked bits of a page column
+ *
+ * @param page
+ * @param x
+ * @param bits
+ * @param mask
+ */
+static void display_fb_put(uint8_t page, uint16_t x, uint8_t bits, uint8_t mask)
+{
+    uint8_t *dst = &display_fb_handler.buf[page][x];
+    uint8_t val = ((*dst & ~mask) | (bits & mask));
+
+    if (val == *dst)
+    {
+        return;
+    }
+    *dst = val;
+
+    if (x < display_fb_handler.dirty_x0[page])
+    {
+        display_fb_handler.dirty_x0[page] = x;
+    }
+    if (x > display_fb_handler.dirty_x1[page])
+    {
+        display_fb_handler.dirty_x1[page] = x;
+    }
+}
+
+/**
+ * @brief display_fb_pixel
+ *
+ * @param x
+ * @param y
+ */
+static void display_fb_pixel(uint16_t x, uint16_t y)
+{
+    if ((x < DISPLAY_FB_WIDTH) && (y < DISPLAY_FB_HEIGHT))
+    {
+        uint8_t bit = BIT(y % DISPLAY_FB_PAGE_ROWS);
+
+        display_fb_put((y / DISPLAY_FB_PAGE_ROWS), x, bit, bit);
+    }
+}
+
+/**
+ * @brief display_fb_clean
+ *
+ * @param page
+ */
+static void display_fb_clean(uint8_t page)
+{
+    display_fb_handler.dirty_x0[page] = (DISPLAY_FB_WIDTH - 1);
+    display_fb_handler.dirty_x1[page] = 0;
+}
+
+/**
+ * @brief display_fb_reverse; bit order of MSB first fonts
+ *
+ * @param b
+ * @return uint8_t
+ */
+static inline uint8_t display_fb_reverse(uint8_t b)
+{
+    b = (uint8_t)(((b & 0xF0) >> 4) | ((b & 0x0F) << 4));
+    b = (uint8_t)(((b & 0xCC) >> 2) | ((b & 0x33) << 2));
+    return (uint8_t)(((b & 0xAA) >> 1) | ((b & 0x55) << 1));
+}
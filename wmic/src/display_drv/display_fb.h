@@ -0,0 +1,23 @@
+#ifndef DISPLAY_FB_H
+#define DISPLAY_FB_H
+
+#include <zephyr/device.h>
+#include <stdint.h>
+
+#define DISPLAY_FB_WIDTH 128
+#define DISPLAY_FB_HEIGHT 64
+#define DISPLAY_FB_PAGE_ROWS 8 // SSD1306 page, a byte holds 8 rows of a column
+#define DISPLAY_FB_PAGES (DISPLAY_FB_HEIGHT / DISPLAY_FB_PAGE_ROWS)
+
+int display_fb_init(const struct device *display);
+void display_fb_clear(void);
+uint8_t display_fb_fonts_num(void);
+int display_fb_font_size(uint8_t font_idx, uint8_t *width, uint8_t *height);
+uint16_t display_fb_print(const char *str, uint16_t x, uint16_t y, uint8_t font_idx);
+void display_fb_rect(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+void display_fb_bar(uint16_t x, uint8_t page, uint16_t width, uint8_t percent);
+void display_fb_meter(uint16_t x, uint8_t page, uint16_t width, uint8_t percent);
+void display_fb_invert(uint16_t x0, uint16_t x1, uint8_t page0, uint8_t page1);
+int display_fb_flush(void);
+
+#endif // DISPLAY_FB_H
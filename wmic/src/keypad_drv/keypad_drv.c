@@ -21,23 +21,62 @@ enum pcf_bank_idx_e
 };
 
 #define KEYPAD_DRV_BTN_NUM 8
+#define KEYPAD_DRV_THREAD_STACK (1024)
+#define KEYPAD_DRV_THREAD_PRIORITY 7
+#define KEYPAD_DRV_EVT_QUEUE_LEN 16
 
 static int keypad_drv_bank_1_conf(void);
 static int keypad_drv_bank_2_conf(void);
+static int keypad_drv_int_conf(const struct gpio_dt_spec *int_gpio);
+static void keypad_drv_int_cb(const struct device *dev, struct gpio_callback *cb, uint32_t pins);
+static void keypad_drv_thread(void *p1, void *p2, void *p3);
+static int keypad_drv_port_read(uint8_t *raw);
+static void keypad_drv_commit(uint8_t pressed, int64_t now);
+static void keypad_drv_hold(int64_t now);
+static k_timeout_t keypad_drv_timeout(int64_t now);
+static void keypad_drv_publish(enum keypad_drv_evt_e type, int btn, int64_t now);
+
+K_THREAD_STACK_DEFINE(keypad_drv_stack, KEYPAD_DRV_THREAD_STACK);
+static struct k_thread keypad_drv_tcb;
+
+K_MSGQ_DEFINE(keypad_drv_evt_msgq, sizeof(struct keypad_drv_evt), KEYPAD_DRV_EVT_QUEUE_LEN, 4);
+K_SEM_DEFINE(keypad_drv_int_sem, 0, 1);
 
 struct keypad_drv_handler_t
 {
     const struct device *pcf[PCF_NUM];
-    gpio_port_value_t buttons_state;
     uint16_t led_state; 
+
+    // Change detection
+    const struct gpio_dt_spec *int_gpio; // PCF8574 INT line, NULL when the port is polled
+    struct gpio_callback int_cb;
+    keypad_drv_notify_cb notify;
+
+    // Debounce
+    uint8_t raw;       // Last port read, bit n set = button n + 1 down
+    uint8_t pressed;   // Debounced state
+    bool settling;     // Raw state differs from the debounced one
+    int64_t settle_ms; // Raw state accepted at this time if still unchanged
+    bool retry;        // Last port read failed, INT is still asserted
+
+    // Gestures
+    uint8_t long_sent;                       // Long press already reported
+    int64_t press_ms[KEYPAD_DRV_BTN_NUM];    // Press time
+    int64_t next_ms[KEYPAD_DRV_BTN_NUM];     // Next long press or repeat event
+    uint32_t evt_dropped;
 } static keypad_drv_handler;
 
 /**
  * @brief keypad_drv_config
  * 
+ * Without the INT line the thread falls back to reading the port every
+ * KEYPAD_DRV_POLL_MS, debounce and gestures are the same.
+ * 
+ * @param int_gpio PCF8574 INT line, NULL if not wired
+ * @param notify called from the keypad thread after each queued event, can be NULL
  * @return int 
  */
-int keypad_drv_config(void)
+int keypad_drv_config(const struct gpio_dt_spec *int_gpio, keypad_drv_notify_cb notify)
 {
     // Buttons bank
     if(keypad_drv_bank_1_conf() < 0)
@@ -53,18 +92,52 @@ int keypad_drv_config(void)
 
     gpio_port_set_bits_raw(keypad_drv_handler.pcf[PCF_LED_BANK_1], 255);
 
+    keypad_drv_handler.notify = notify;
+    if ((int_gpio != NULL) && (keypad_drv_int_conf(int_gpio) < 0))
+    {
+        return -1;
+    }
+
+    k_thread_create(&keypad_drv_tcb,
+                    keypad_drv_stack,
+                    KEYPAD_DRV_THREAD_STACK,
+                    keypad_drv_thread,
+                    NULL, NULL, NULL,
+                    KEYPAD_DRV_THREAD_PRIORITY, 0, K_NO_WAIT);
+
     return 0;
 }
 
 /**
- * @brief keypad_drv_btn_read
+ * @brief keypad_drv_evt_get
+ * 
+ * @param evt 
+ * @param timeout 
+ * @return int 0 on success, negative if no event within the timeout
+ */
+int keypad_drv_evt_get(struct keypad_drv_evt *evt, k_timeout_t timeout)
+{
+    return k_msgq_get(&keypad_drv_evt_msgq, evt, timeout);
+}
+
+/**
+ * @brief keypad_drv_evt_dropped; events lost on a full queue
+ * 
+ * @return uint32_t 
+ */
+uint32_t keypad_drv_evt_dropped(void)
+{
+    return keypad_drv_handler.evt_dropped;
+}
+
+/**
+ * @brief keypad_drv_btn_read; debounced state, no I2C access
  * 
- * @return uint8_t 
+ * @return enum buttons_e 
  */
 enum buttons_e keypad_drv_btn_read(void)
 {
-    gpio_port_get_raw(keypad_drv_handler.pcf[PCF_BTN_BANK_1], &keypad_drv_handler.buttons_state);
-    return (enum buttons_e)keypad_drv_handler.buttons_state;
+    return (enum buttons_e)(uint8_t)~keypad_drv_handler.pressed;
 }
 
 /**
@@ -133,4 +206,251 @@ static int keypad_drv_bank_2_conf(void)
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief keypad_drv_int_conf
+ * 
+ * The PCF8574 pulls INT low on any input change and releases it when the
+ * port is read. The line is level triggered: the interrupt is masked until
+ * the thread has read the port, so a change missed by a failed read is
+ * still signalled once it is armed again.
+ * 
+ * @param int_gpio 
+ * @return int 
+ */
+static int keypad_drv_int_conf(const struct gpio_dt_spec *int_gpio)
+{
+    if (!gpio_is_ready_dt(int_gpio))
+    {
+        printk("PCF8574 INT not ready\n");
+        return -1;
+    }
+
+    keypad_drv_handler.int_gpio = int_gpio;
+
+    gpio_pin_configure_dt(int_gpio, GPIO_INPUT);
+    gpio_init_callback(&keypad_drv_handler.int_cb, keypad_drv_int_cb, BIT(int_gpio->pin));
+    gpio_add_callback(int_gpio->port, &keypad_drv_handler.int_cb);
+    // Armed by the thread after its first port read
+
+    return 0;
+}
+
+/**
+ * @brief keypad_drv_int_cb
+ * 
+ * @param dev 
+ * @param cb 
+ * @param pins 
+ */
+static void keypad_drv_int_cb(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    // Masked until the port is read, the level would fire again meanwhile
+    gpio_pin_interrupt_configure_dt(keypad_drv_handler.int_gpio, GPIO_INT_DISABLE);
+    k_sem_give(&keypad_drv_int_sem);
+}
+
+/**
+ * @brief keypad_drv_thread
+ * 
+ * The port is read on INT (or every KEYPAD_DRV_POLL_MS without it) and once
+ * more when the debounce window expires. A raw change restarts the window,
+ * the state is accepted only after KEYPAD_DRV_DEBOUNCE_MS without changes.
+ * Long press and repeat deadlines need no I2C access, releases come with
+ * their own INT. A failed read is retried every KEYPAD_DRV_RETRY_MS, the
+ * INT line is armed again only after a successful one.
+ * 
+ * @param p1 
+ * @param p2 
+ * @param p3 
+ */
+static void keypad_drv_thread(void *p1, void *p2, void *p3)
+{
+    // Pick up buttons already held at start-up
+    k_sem_give(&keypad_drv_int_sem);
+
+    while (1)
+    {
+        bool wake = (k_sem_take(&keypad_drv_int_sem, keypad_drv_timeout(k_uptime_get())) == 0);
+        int64_t now = k_uptime_get();
+
+        if (wake || keypad_drv_handler.settling || keypad_drv_handler.retry || (keypad_drv_handler.int_gpio == NULL))
+        {
+            uint8_t raw;
+
+            keypad_drv_handler.retry = (keypad_drv_port_read(&raw) < 0);
+            if (keypad_drv_handler.retry)
+            {
+                keypad_drv_hold(now);
+                continue;
+            }
+            if (keypad_drv_handler.int_gpio != NULL)
+            {
+                gpio_pin_interrupt_configure_dt(keypad_drv_handler.int_gpio, GPIO_INT_LEVEL_ACTIVE);
+            }
+
+            if (raw != keypad_drv_handler.raw)
+            {
+                keypad_drv_handler.raw = raw;
+                keypad_drv_handler.settling = true;
+                keypad_drv_handler.settle_ms = (now + KEYPAD_DRV_DEBOUNCE_MS);
+            }
+            else if (keypad_drv_handler.settling && (now >= keypad_drv_handler.settle_ms))
+            {
+                keypad_drv_handler.settling = false;
+                keypad_drv_commit(raw, now);
+            }
+        }
+
+        keypad_drv_hold(now);
+    }
+}
+
+/**
+ * @brief keypad_drv_port_read
+ * 
+ * @param raw buttons down, bit n set = button n + 1
+ * @return int negative on I2C error, raw is not written
+ */
+static int keypad_drv_port_read(uint8_t *raw)
+{
+    gpio_port_value_t port;
+
+    if (gpio_port_get_raw(keypad_drv_handler.pcf[PCF_BTN_BANK_1], &port) < 0)
+    {
+        return -1;
+    }
+
+    *raw = (uint8_t)~port; // Buttons pull the inputs low
+
+    return 0;
+}
+
+/**
+ * @brief keypad_drv_commit; press and release events of a debounced change
+ * 
+ * @param pressed 
+ * @param now 
+ */
+static void keypad_drv_commit(uint8_t pressed, int64_t now)
+{
+    uint8_t changed = (pressed ^ keypad_drv_handler.pressed);
+
+    keypad_drv_handler.pressed = pressed;
+
+    for (int i = 0; i < KEYPAD_DRV_BTN_NUM; i++)
+    {
+        if (!(changed & BIT(i)))
+        {
+            continue;
+        }
+
+        if (pressed & BIT(i))
+        {
+            keypad_drv_handler.press_ms[i] = now;
+            keypad_drv_handler.next_ms[i] = (now + KEYPAD_DRV_LONG_MS);
+            keypad_drv_publish(KEYPAD_EVT_PRESS, i, now);
+        }
+        else
+        {
+            keypad_drv_handler.long_sent &= ~BIT(i);
+            keypad_drv_publish(KEYPAD_EVT_RELEASE, i, now);
+        }
+    }
+}
+
+/**
+ * @brief keypad_drv_hold; long press, then auto-repeat while held
+ * 
+ * @param now 
+ */
+static void keypad_drv_hold(int64_t now)
+{
+    for (int i = 0; i < KEYPAD_DRV_BTN_NUM; i++)
+    {
+        if (!(keypad_drv_handler.pressed & BIT(i)) || (now < keypad_drv_handler.next_ms[i]))
+        {
+            continue;
+        }
+
+        if (keypad_drv_handler.long_sent & BIT(i))
+        {
+            keypad_drv_publish(KEYPAD_EVT_REPEAT, i, now);
+        }
+        else
+        {
+            keypad_drv_handler.long_sent |= BIT(i);
+            keypad_drv_publish(KEYPAD_EVT_LONG, i, now);
+        }
+        keypad_drv_handler.next_ms[i] += KEYPAD_DRV_REPEAT_MS;
+    }
+}
+
+/**
+ * @brief keypad_drv_timeout; time to the next debounce or hold deadline
+ * 
+ * @param now 
+ * @return k_timeout_t 
+ */
+static k_timeout_t keypad_drv_timeout(int64_t now)
+{
+    int64_t next = INT64_MAX;
+
+    if (keypad_drv_handler.settling)
+    {
+        next = keypad_drv_handler.settle_ms;
+    }
+
+    for (int i = 0; i < KEYPAD_DRV_BTN_NUM; i++)
+    {
+        if ((keypad_drv_handler.pressed & BIT(i)) && (keypad_drv_handler.next_ms[i] < next))
+        {
+            next = keypad_drv_handler.next_ms[i];
+        }
+    }
+
+    if (keypad_drv_handler.retry)
+    {
+        next = MIN(next, (now + KEYPAD_DRV_RETRY_MS));
+    }
+    else if (keypad_drv_handler.int_gpio == NULL)
+    {
+        next = MIN(next, (now + KEYPAD_DRV_POLL_MS));
+    }
+
+    if (next == INT64_MAX)
+    {
+        return K_FOREVER;
+    }
+
+    return (next > now) ? K_MSEC(next - now) : K_NO_WAIT;
+}
+
+/**
+ * @brief keypad_drv_publish
+ * 
+ * @param type 
+ * @param btn button index, 0 = BUTTON_1
+ * @param now 
+ */
+static void keypad_drv_publish(enum keypad_drv_evt_e type, int btn, int64_t now)
+{
+    struct keypad_drv_evt evt = {
+        .type = type,
+        .btn = (enum buttons_e)(uint8_t)~BIT(btn),
+        .pressed = keypad_drv_handler.pressed,
+        .held_ms = (uint32_t)(now - keypad_drv_handler.press_ms[btn]),
+    };
+
+    if (k_msgq_put(&keypad_drv_evt_msgq, &evt, K_NO_WAIT) != 0)
+    {
+        keypad_drv_handler.evt_dropped++;
+        return;
+    }
+
+    if (keypad_drv_handler.notify != NULL)
+    {
+        keypad_drv_handler.notify();
+    }
+}
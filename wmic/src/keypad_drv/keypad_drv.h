@@ -2,9 +2,16 @@
 #define KEYPAD_DRV_H
 
 #include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
 
 #include <stdint.h>
 
+#define KEYPAD_DRV_DEBOUNCE_MS 10 // Port state must be stable this long before it is accepted
+#define KEYPAD_DRV_LONG_MS 600    // Hold time of a long press
+#define KEYPAD_DRV_REPEAT_MS 150  // Auto-repeat period after a long press
+#define KEYPAD_DRV_POLL_MS 100    // Port read period when the INT line is not wired
+#define KEYPAD_DRV_RETRY_MS 10    // Port read retry after an I2C error
+
 enum buttons_e
 {
     BUTTON_1 = (uint8_t)~BIT(0),
@@ -31,8 +38,28 @@ enum led_e
     LED_9 = (uint8_t)BIT(8),
 };
 
-int keypad_drv_config(void);
-uint8_t keypad_drv_btn_read(void);
+enum keypad_drv_evt_e
+{
+    KEYPAD_EVT_PRESS = 0,
+    KEYPAD_EVT_RELEASE,
+    KEYPAD_EVT_LONG,
+    KEYPAD_EVT_REPEAT,
+};
+
+struct keypad_drv_evt
+{
+    enum keypad_drv_evt_e type;
+    enum buttons_e btn; // Button the event refers to
+    uint8_t pressed;    // Debounced buttons held, bit n set = button n + 1 down
+    uint32_t held_ms;   // Time since the press
+};
+
+typedef void (*keypad_drv_notify_cb)(void);
+
+int keypad_drv_config(const struct gpio_dt_spec *int_gpio, keypad_drv_notify_cb notify);
+int keypad_drv_evt_get(struct keypad_drv_evt *evt, k_timeout_t timeout);
+uint32_t keypad_drv_evt_dropped(void);
+enum buttons_e keypad_drv_btn_read(void);
 void keypad_drv_led_clear(uint8_t leds);
 void keypad_drv_led_set(uint8_t leds);
 
@@ -23,8 +23,10 @@
 #include <zephyr/drivers/i2c.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/sys/reboot.h>
+#include <zephyr/settings/settings.h>
 
 #include <stdio.h>
+#include <string.h>
 #include <arm_math.h>
 
 #include "config.h"
@@ -34,12 +36,29 @@
 #include "bluetooth_drv.h"
 #include "signals.h"
 #include "pages.h"
+#include "peer_select.h"
+#include "param_edit.h"
+#include "dsp_prof.h"
+#include "boot.h"
+#include "param_snap.h"
 #if (ENABLE_DSP_FILTER)
 #include "low_pass_filter.h"
 #endif // ENABLE_DSP_FILTER
 #if (ENABLE_DSP_ADT_EFFECT)
 #include "adt.h"
 #endif // ENABLE_DSP_ADT_EFFECT
+#if (ENABLE_LATENCY_MEAS)
+#if (ENABLE_SIGNAL_GEN)
+#error "ENABLE_LATENCY_MEAS injects its burst through the signal generator, disable ENABLE_SIGNAL_GEN"
+#endif // ENABLE_SIGNAL_GEN
+#include "latency.h"
+#endif // ENABLE_LATENCY_MEAS
+#if (ENABLE_DITHER)
+#include "dither.h"
+#endif // ENABLE_DITHER
+#if (ENABLE_STEREO_DIFF)
+#include "balanced.h"
+#endif // ENABLE_STEREO_DIFF
 
 const float max = MAX_LIMIT;
 const float min = MIN_LIMIT;
@@ -48,19 +67,15 @@ const float min = MIN_LIMIT;
 const struct gpio_dt_spec led = GPIO_DT_SPEC_GET(DT_NODELABEL(led1), gpios);
 
 #if (ENABLE_INPUTS_INT)
-#define INPUTS_N 4
-// Inputs data structures
-const struct gpio_dt_spec inputs[INPUTS_N] = {GPIO_DT_SPEC_GET(DT_NODELABEL(input1), gpios),
-                                              GPIO_DT_SPEC_GET(DT_NODELABEL(input2), gpios),
-                                              GPIO_DT_SPEC_GET(DT_NODELABEL(input3), gpios),
-                                              GPIO_DT_SPEC_GET(DT_NODELABEL(input4), gpios)};
-static struct gpio_callback inputs_cb;
+// Keypad expander INT line
+const struct gpio_dt_spec keypad_int = GPIO_DT_SPEC_GET(DT_NODELABEL(keypad_int), gpios);
+#define KEYPAD_INT_GPIO (&keypad_int)
+#else
+#define KEYPAD_INT_GPIO NULL
 #endif // ENABLE_INPUTS_INT
-uint8_t right;
-uint8_t left;
-uint8_t set;
-
 static int64_t display_stb_timer = 0;
+static int64_t dsp_prof_timer = 0;
+static atomic_t bt_link_lost = ATOMIC_INIT(0); // Output muted and DSP paused until the link is back
 
 // I2S data structures
 const struct device *i2s_dev = DEVICE_DT_GET(DT_NODELABEL(i2s0));
@@ -71,82 +86,217 @@ const struct device *uart0_dev = DEVICE_DT_GET(DT_NODELABEL(uart0));
 // I2C data structures
 const struct device *i2c1_dev = DEVICE_DT_GET(DT_NODELABEL(i2c1));
 
-// Audio effects data structures
+// Audio effects data structures, edited on the UI side and published to the audio thread as a whole
 static audio_effects_handler_t audio_effects_handler;
+PARAM_SNAP_DEFINE(audio_effects_snap, audio_effects_handler_t);
+// Generation of the settings applied to the stages, audio thread only
+static uint32_t audio_effects_gen;
+
+#if (ENABLE_DSP_ADT_EFFECT)
+// ADT parameters, edited from the keypad
+enum adt_par_e
+{
+    ADT_PAR_EN = 0,
+    ADT_PAR_DELAY,
+    ADT_PAR_FADING,
+    ADT_PAR_N
+};
+
+static void adt_apply(const int16_t *val);
+
+static const struct param_edit_par adt_pars[ADT_PAR_N] = {
+    [ADT_PAR_EN] = {.title = "EN", .min = 0, .max = 1, .step = 1, .def = 0},
+    [ADT_PAR_DELAY] = {.title = "DEL", .min = ADT_DELAY_MIN_MS, .max = ADT_DELAY_MAX_MS, .step = 10, .def = ADT_DELAY_DEF_MS},
+    [ADT_PAR_FADING] = {.title = "AMP", .min = 0, .max = 15, .step = 1, .def = 0},
+};
+
+static const struct param_edit_cfg adt_edit_cfg = {
+    .par = adt_pars,
+    .par_num = ADT_PAR_N,
+    .apply = adt_apply,
+};
+
+// Delay the line runs with, audio thread only
+static uint16_t adt_delay = ADT_DELAY_DEF_MS;
+
+// Second track of the block
+static q31_t adt_out[DATA_BUFFER_SIZE];
+#if (!ENABLE_STEREO_DIFF)
+static q31_t adt_in[DATA_BUFFER_SIZE];
+#endif // ENABLE_STEREO_DIFF
+#endif // ENABLE_DSP_ADT_EFFECT
+
+// Keys chords (bit n = button n + 1), the first button action is overridden by the reset
+#define INPUTS_CHORD_PAR_RESET (BIT(0) | BIT(1)) // Up + down, selected parameter to default
+#define INPUTS_CHORD_ALL_RESET (BIT(2) | BIT(3)) // Select + enable, all parameters to default
+
+#if (ENABLE_STEREO_DIFF)
+// Deinterleaved mono buffer
+static q31_t mono_buff[DATA_BUFFER_SIZE];
+#endif // ENABLE_STEREO_DIFF
 
 static void workq_100ms(struct k_work *work);
 
 #if (ENABLE_DSP_FILTER)
 static void dsp_filter_init();
+#if (ENABLE_STEREO_DIFF)
+static void dsp_filter_mono(q31_t *mono, uint32_t len);
+#else
 static void dsp_filter(int32_t *pmem);
+#endif // ENABLE_STEREO_DIFF
 #endif // ENABLE_DSP_FILTER
 #if (ENABLE_DSP_ADT_EFFECT)
-static void dsp_adt_init(void);
-static void dsp_adt(int32_t *sample);
+static void dsp_adt(const q31_t *in, int32_t *pmem, uint32_t frames);
+static void adt_page_show(void);
 #endif // ENABLE_DSP_ADT_EFFECT
 static void dsp_amplifier(int32_t *sample);
+static bool dsp_params_update(void);
+#if (ENABLE_STEREO_DIFF)
+static void dsp_interleave(const q31_t *mono, int32_t *pmem, uint32_t frames);
+#endif // ENABLE_STEREO_DIFF
 
+static int dsp_init(void);
 static int gpios_init(void);
-static int display_and_keypad(void);
+static int display_init(void);
+static int keypad_init(void);
 static int bt_init(void);
 static int audio_init(void);
-
-static void inputs_handler_cb(void);
+static int app_start(void);
+
+static void inputs_notify(void);
+static void inputs_work_handler(struct k_work *work);
+static void inputs_handler_cb(const struct keypad_drv_evt *evt);
+#if (ENABLE_LATENCY_MEAS)
+static void latency_done(const struct latency_result *res);
+#endif // ENABLE_LATENCY_MEAS
 static void data_elab(int32_t *pmem, uint32_t block_size);
-static uint16_t bt_peer_select(const struct bluetooth_peers *peers, const int16_t *size);
+static void bt_event(enum bluetooth_drv_evt_e evt);
+static void bt_link_event(const struct bluetooth_drv_link_evt *evt);
 
 static void display_stb(void);
 
 static void system_fault_handler(void);
 
 K_WORK_DELAYABLE_DEFINE(workq, workq_100ms);
+K_WORK_DEFINE(inputs_work, inputs_work_handler);
 
-int main(void)
+// Boot stages, a stage starts as soon as the ones in its deps are done
+enum boot_stage_e
 {
-    // Filter init
-#if (ENABLE_DSP_FILTER)
-    dsp_filter_init();
-#endif // ENABLE_DSP_FILTER
+    BOOT_GPIO = 0,
+    BOOT_DSP,
+    BOOT_UI,
+    BOOT_KEYPAD,
+#if (!DEBUG_MODE)
+    BOOT_AUDIO,
+    BOOT_BT,
+#endif // DEBUG_MODE
+    BOOT_APP,
+    BOOT_STAGES_N
+};
+
+static const struct boot_stage boot_stages[BOOT_STAGES_N] = {
+    [BOOT_GPIO] = {.name = "GPIO", .init = gpios_init, .deps = 0, .fatal = true},
+    [BOOT_DSP] = {.name = "DSP", .init = dsp_init, .deps = 0, .fatal = true},
+    [BOOT_UI] = {.name = "UI", .init = display_init, .deps = 0, .fatal = true},
+    // Keypad events edit the effects, their snapshot must have been published by the DSP init first
+    [BOOT_KEYPAD] = {.name = "KEYPAD", .init = keypad_init, .deps = (BOOT_DEP(BOOT_DSP) | BOOT_DEP(BOOT_UI)), .fatal = true},
+#if (!DEBUG_MODE)
+    [BOOT_AUDIO] = {.name = "AUDIO", .init = audio_init, .deps = BOOT_DEP(BOOT_DSP), .fatal = true},
+    [BOOT_BT] = {.name = "BT", .init = bt_init, .deps = 0, .fatal = false},
+    [BOOT_APP] = {.name = "APP", .init = app_start, .deps = (BOOT_DEP(BOOT_GPIO) | BOOT_DEP(BOOT_KEYPAD) | BOOT_DEP(BOOT_AUDIO)), .fatal = true},
+#else
+    [BOOT_APP] = {.name = "APP", .init = app_start, .deps = (BOOT_DEP(BOOT_GPIO) | BOOT_DEP(BOOT_KEYPAD)), .fatal = true},
+#endif // DEBUG_MODE
+};
 
-    // GPIOS init
-    if (gpios_init() != 0)
+int main(void)
+{
+    // Subsystems are brought up concurrently, audio doesn't wait for the BT module
+    if (boot_run(boot_stages, BOOT_STAGES_N) != 0)
     {
-        printk("GPIO init failed, resetting...\n");
+        printk("Boot failed, resetting...\n");
         system_fault_handler();
     }
 
-    // display init
-    if (display_and_keypad() != 0)
-    {
-        printk("Display and keypad init failed, resetting...\n");
-        system_fault_handler();
-    }
-#if (!DEBUG_MODE)
-    // Bluetooth init
-    if (bt_init() != 0)
+    while (1)
     {
-        printk("Bluetooth init failed, resetting...\n");
+        k_sleep(K_FOREVER);
     }
+    return 0;
+}
+
+/**
+ * @brief dsp_init
+ *
+ * @return int
+ */
+static int dsp_init(void)
+{
+    // DSP profiler init
+    dsp_prof_init();
+
+    // Signal generator init
+#if (ENABLE_SIGNAL_GEN)
+    struct signals_cfg sig_cfg = {
+        .fs = SAMPLE_FREQ,
+        .tones_n = 1,
+        .tone[0] = {.wave = SIG_GEN_WAVE, .freq = SIG_GEN_FREQ, .amp = SIG_GEN_AMP},
+        .sweep = SIG_SWEEP_NONE,
+    };
+    signals_init(&sig_cfg);
+#endif // ENABLE_SIGNAL_GEN
+
+    // Balanced input init
+#if (ENABLE_STEREO_DIFF)
+    balanced_init(BALANCED_CAL_MS / BUFFER_BLOCK_TIME_MS);
+#endif // ENABLE_STEREO_DIFF
+
+    // Dither init
+#if (ENABLE_DITHER)
+    dither_init(DITHER_SHAPER);
+#endif // ENABLE_DITHER
+
+    // Latency measurement init
+#if (ENABLE_LATENCY_MEAS)
+    latency_init(SAMPLE_FREQ, audio_drv_io_frames(), latency_done);
+#endif // ENABLE_LATENCY_MEAS
+
+    // Filter init
+#if (ENABLE_DSP_FILTER)
+    dsp_filter_init();
+#endif // ENABLE_DSP_FILTER
 
-    // Audio init
-    if (audio_init() != 0)
+    // Effects settings, the audio thread runs on published copies only. The
+    // system workqueue is the only writer afterwards: the keypad starts once
+    // this stage is done.
+    param_snap_publish(&audio_effects_snap, &audio_effects_handler);
+
+    // ADT init, publishes the defaults, the delay line follows the edits from the first block
+#if (ENABLE_DSP_ADT_EFFECT)
+    adt_init(ADT_DELAY_DEF_MS);
+    if (param_edit_init(&adt_edit_cfg) != 0)
     {
-        printk("Audio init failed, resetting...\n");
-        system_fault_handler();
+        return -1;
     }
-#endif //DEBUG_MODE
-    k_sleep(K_MSEC(500));
+#endif // ENABLE_DSP_ADT_EFFECT
 
+    return 0;
+}
+
+/**
+ * @brief app_start
+ *
+ * @return int
+ */
+static int app_start(void)
+{
     // App is running
     gpio_pin_set(led.port, led.pin, 1);
 
     // Schedule 100ms work queue
-    k_work_schedule(&workq, K_SECONDS(1));
+    k_work_schedule(&workq, K_NO_WAIT);
 
-    while (1)
-    {
-        k_sleep(K_FOREVER);
-    }
     return 0;
 }
 
@@ -157,19 +307,16 @@ int main(void)
  */
 static void workq_100ms(struct k_work *work)
 {
-    // ADT init
-#if (ENABLE_DSP_ADT_EFFECT)
-    if (audio_effects_handler.adt_set.EnDis > 0)
+    display_stb();
+
+    // Periodic report of the DSP cost per block and of the page render time
+    if ((k_uptime_get() - dsp_prof_timer) > DSP_PROF_REPORT_MS)
     {
-        dsp_adt_init();
+        dsp_prof_timer = k_uptime_get();
+        dsp_prof_report();
+        display_drv_report();
     }
-#endif // ENABLE_DSP_ADT_EFFECT
-
-#if (!ENABLE_INPUTS_INT)
-    inputs_handler_cb();
-#endif // ENABLE_INPUTS_INT
 
-    display_stb();
     k_work_schedule(&workq, K_MSEC(100));
 }
 
@@ -181,10 +328,39 @@ static void workq_100ms(struct k_work *work)
  */
 static void dsp_filter_init(void)
 {
+#if (ENABLE_STEREO_DIFF)
+    lowpass_filter_init(MAX_BLOCK_LEN); // Mono buffer processed in chunks
+#else
     lowpass_filter_init(1); // block_len = 1
+#endif // ENABLE_STEREO_DIFF
     return;
 }
 
+#if (ENABLE_STEREO_DIFF)
+/**
+ * @brief dsp_filter_mono
+ *
+ * @param mono
+ * @param len
+ */
+static void dsp_filter_mono(q31_t *mono, uint32_t len)
+{
+    q15_t data_q15[MAX_BLOCK_LEN];
+    q15_t out[MAX_BLOCK_LEN];
+
+    for (uint32_t i = 0; i < len; i += MAX_BLOCK_LEN)
+    {
+        uint16_t n = MIN(MAX_BLOCK_LEN, (len - i));
+
+        arm_q31_to_q15(&mono[i], data_q15, n); // Conversion from q31 to q15
+        lowpass_filter_exc_block(data_q15, out, n);
+        for (uint16_t j = 0; j < n; j++)
+        {
+            mono[i + j] = ((q31_t)out[j] << 16); // Conversion from q15 to q31
+        }
+    }
+}
+#else
 /**
  * @brief dsp_filter
  *
@@ -195,16 +371,7 @@ static void dsp_filter(int32_t *pmem)
     float32_t data_f32 = 0.0;
     q15_t data_q15;
     q15_t out;
-    int32_t filtered;
 
-#if (ENABLE_STEREO_DIFF)
-    data_f32 = ((pmem[0]) / (float32_t)2147483648); // Normalization from int32 to float32 (range -1.0 to 1.0)
-    arm_float_to_q15(&data_f32, &data_q15, 1);      // Conversion from float32 to 15
-    lowpass_filter_exc(&data_q15, &out);
-    filtered = (int32_t)(out * (65536)); // Conversion from q15 to int32 (2147483648 / 32768 = 65536)
-    pmem[0] = filtered;                  // Left channel
-    pmem[1] = filtered;                  // Right channel (equal to left)
-#else
     // Left channel
     data_f32 = ((pmem[0]) / (float32_t)2147483648);
     arm_float_to_q15(&data_f32, &data_q15, 1);
@@ -216,35 +383,90 @@ static void dsp_filter(int32_t *pmem)
     arm_float_to_q15(&data_f32, &data_q15, 1);
     lowpass_filter_exc(&data_q15, &out);
     pmem[1] = (int32_t)(out * (2147483648 / 32768));
-#endif // ENABLE_STEREO_DIFF
 
     return;
 }
+#endif // ENABLE_STEREO_DIFF
 #endif // ENABLE_DSP_FILTER
 
 #if (ENABLE_DSP_ADT_EFFECT)
 /**
- * @brief dsp_adt_init
+ * @brief dsp_adt; input on the left channel, second track on the right one
  *
+ * @param in
+ * @param pmem
+ * @param frames
  */
-static void dsp_adt_init(void)
+static void dsp_adt(const q31_t *in, int32_t *pmem, uint32_t frames)
 {
-    uint16_t delay = (audio_effects_handler.adt_set.delay * 100);
-    adt_init(delay);
+    adt_process(in, adt_out, frames);
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        pmem[2 * i] = in[i];
+        pmem[(2 * i) + 1] = adt_out[i];
+    }
 }
 
 /**
- * @brief dsp_adt
+ * @brief adt_apply; edited parameters to the UI copy, then published to the audio thread
+ *
+ * @param val
+ */
+static void adt_apply(const int16_t *val)
+{
+    audio_effects_handler.adt_set.EnDis = (uint8_t)val[ADT_PAR_EN];
+    audio_effects_handler.adt_set.delay = (uint16_t)val[ADT_PAR_DELAY];
+    audio_effects_handler.adt_set.fading_lev = (uint8_t)val[ADT_PAR_FADING];
+
+    param_snap_publish(&audio_effects_snap, &audio_effects_handler);
+}
+
+/**
+ * @brief adt_page_show; the selected parameter is highlighted, EN on the title
  *
- * @param sample
  */
-static void dsp_adt(int32_t *sample)
+static void adt_page_show(void)
 {
-    adt_store_sample(sample[0]);
-    sample[1] = (adt_get_sample() >> audio_effects_handler.adt_set.fading_lev);
+    pages_adt_page(audio_effects_handler.adt_set, param_edit_selected());
 }
 #endif // ENABLE_DSP_ADT_EFFECT
 
+/**
+ * @brief dsp_params_update; take the newest published settings, once per block
+ *
+ * Settings are handed to the stages only on a new generation, the stages
+ * ramp or crossfade to them over the next samples. The previous block is
+ * already given back to the writer at this point.
+ *
+ * @return bool false if nothing has been published yet
+ */
+static bool dsp_params_update(void)
+{
+    uint32_t gen;
+    const audio_effects_handler_t *params = param_snap_read(&audio_effects_snap, &gen);
+
+    if (params == NULL)
+    {
+        return false;
+    }
+
+    if (gen != audio_effects_gen)
+    {
+        audio_effects_gen = gen;
+#if (ENABLE_DSP_ADT_EFFECT)
+        adt_set_mix((params->adt_set.EnDis > 0), params->adt_set.fading_lev);
+        if (params->adt_set.delay != adt_delay)
+        {
+            adt_delay = params->adt_set.delay;
+            adt_set_delay(adt_delay);
+        }
+#endif // ENABLE_DSP_ADT_EFFECT
+    }
+
+    return true;
+}
+
 /**
  * @brief dsp_amplifier
  *
@@ -266,6 +488,24 @@ static void dsp_amplifier(int32_t *sample)
     return;
 }
 
+#if (ENABLE_STEREO_DIFF)
+/**
+ * @brief dsp_interleave; duplicate the mono buffer on both channels
+ *
+ * @param mono
+ * @param pmem
+ * @param frames
+ */
+static void dsp_interleave(const q31_t *mono, int32_t *pmem, uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        pmem[2 * i] = mono[i];
+        pmem[(2 * i) + 1] = mono[i];
+    }
+}
+#endif // ENABLE_STEREO_DIFF
+
 /**
  * @brief gpios_init
  *
@@ -280,34 +520,15 @@ static int gpios_init(void)
     }
     gpio_pin_configure_dt(&led, GPIO_OUTPUT_ACTIVE);
 
-#if (ENABLE_INPUTS_INT)
-    int inputs_bit = 0;
-    // Inputs
-    for (int i = 0; i < INPUTS_N; i++)
-    {
-        inputs_bit |= BIT(inputs[i].pin);
-
-        if (!gpio_is_ready_dt(&inputs[i]))
-        {
-            return -1;
-        }
-        gpio_pin_configure_dt(&inputs[i], GPIO_INPUT);
-        gpio_pin_interrupt_configure_dt(&inputs[i], GPIO_INT_EDGE_TO_ACTIVE);
-    }
-
-    gpio_init_callback(&inputs_cb, inputs_handler_cb, inputs_bit);
-    gpio_add_callback(inputs[0].port, &inputs_cb);
-#endif // ENABLE_INPUTS_INT
-
     return 0;
 }
 
 /**
- * @brief display_and_keypad
+ * @brief display_init
  *
  * @return int
  */
-static int display_and_keypad(void)
+static int display_init(void)
 {
     // Check device is ready
     if (!device_is_ready(i2c1_dev))
@@ -316,13 +537,8 @@ static int display_and_keypad(void)
         return -1;
     }
 
-#if (DEBUG_MODE)
-    if (keypad_drv_config() < 0)
-    {
-        return -1;
-    }
-#else
-    if ((display_drv_config() < 0) || (keypad_drv_config() < 0))
+#if (!DEBUG_MODE)
+    if (display_drv_config() < 0)
     {
         return -1;
     }
@@ -330,6 +546,16 @@ static int display_and_keypad(void)
     return 0;
 }
 
+/**
+ * @brief keypad_init; events are delivered on the system workqueue from now on
+ *
+ * @return int
+ */
+static int keypad_init(void)
+{
+    return keypad_drv_config(KEYPAD_INT_GPIO, inputs_notify);
+}
+
 /**
  * @brief bt_init
  *
@@ -344,7 +570,15 @@ static int bt_init(void)
         return -1;
     }
 
-    return bluetooth_drv_config(uart0_dev, bt_peer_select, TXRX_MODULE);
+    // BT peers cache, the only settings user
+    if (settings_subsys_init() != 0)
+    {
+        printf("Settings not available\n");
+    }
+
+    bluetooth_drv_link_subscribe(bt_link_event);
+
+    return bluetooth_drv_config(uart0_dev, bt_event, TXRX_MODULE);
 }
 
 /**
@@ -373,16 +607,74 @@ static void data_elab(int32_t *pmem, uint32_t block_size)
 {
     int size = block_size / sizeof(int32_t);
 
+    boot_mark_audio();
+
+    // Nothing is streamed without link, skip the processing
+    if (atomic_get(&bt_link_lost))
+    {
+        memset(pmem, 0, block_size);
+        return;
+    }
+
+    // Settings for this block, nothing to run the effects with before the first ones are published
+    if (!dsp_params_update())
+    {
+        memset(pmem, 0, block_size);
+        return;
+    }
+
+    dsp_prof_start(DSP_PROF_ELAB);
+    dsp_prof_start(DSP_PROF_CHAIN);
+
+#if (ENABLE_STEREO_DIFF)
+    // Channels are collapsed, mono-safe stages run once on a deinterleaved buffer
+    uint32_t frames = MIN((size / CHANNELS_NUMBER), DATA_BUFFER_SIZE);
+#endif // ENABLE_STEREO_DIFF
+
 #if (ENABLE_SIGNAL_GEN)
+    // Full scale q31 data, bt module considers only the upper 16 bits
+#if (ENABLE_STEREO_DIFF)
+    signals_fill_mono(mono_buff, frames);
+#if (ENABLE_DSP_FILTER)
+    dsp_filter_mono(mono_buff, frames);
+#endif // ENABLE_DSP_FILTER
+    dsp_interleave(mono_buff, pmem, frames);
+#else
+    signals_fill_block(pmem, (size / CHANNELS_NUMBER));
+#if (ENABLE_DSP_FILTER)
     for (int i = 0; i < size - 1; i += 2)
     {
-        pmem[i] = (int32_t)(signals_get_sample() * (float32_t)22767); // Conversion from float32 (range -1.0 to 1.0) to int16
-        pmem[i] = (pmem[i] << 16);                                    // Shift to upper 16 bits (according to bluetooth module data format)
-        pmem[i + 1] = pmem[i];                                        // Right channel equal to left channel
-#if (ENABLE_DSP_FILTER)
         dsp_filter(&pmem[i]);
+    }
 #endif // ENABLE_DSP_FILTER
+#endif // ENABLE_STEREO_DIFF
+#else
+#if (ENABLE_LATENCY_MEAS)
+    // Capture the input and inject the measurement burst, if running
+    latency_process_input(pmem, (size / CHANNELS_NUMBER));
+#endif // ENABLE_LATENCY_MEAS
+#if (ENABLE_STEREO_DIFF)
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        int32_t *frame = &pmem[2 * i];
+
+        if ((frame[0] <= max) && (frame[0] >= min))
+        {
+            dsp_amplifier(&frame[0]);
+            dsp_amplifier(&frame[1]);
+        }
     }
+    // Gain matched right - left
+    balanced_process(pmem, mono_buff, frames);
+#if (ENABLE_DSP_FILTER)
+    dsp_filter_mono(mono_buff, frames);
+#endif // ENABLE_DSP_FILTER
+#if (ENABLE_DSP_ADT_EFFECT)
+    // ADT is the only stage making the two channels different, so it runs at the final interleave
+    dsp_adt(mono_buff, pmem, frames);
+#else
+    dsp_interleave(mono_buff, pmem, frames);
+#endif // ENABLE_DSP_ADT_EFFECT
 #else
     for (int i = 0; i < size - 1; i += 2)
     {
@@ -391,108 +683,247 @@ static void data_elab(int32_t *pmem, uint32_t block_size)
             dsp_amplifier(&pmem[i]);
             dsp_amplifier(&pmem[i + 1]);
         }
-#if (ENABLE_STEREO_DIFF)
-        int32_t diff = pmem[i + 1] - pmem[i]; // right - left
-        pmem[i] = diff;
-        pmem[i + 1] = diff;
-#endif // ENABLE_STEREO_DIFF
 #if (ENABLE_DSP_FILTER)
         dsp_filter(&pmem[i]);
 #endif // ENABLE_DSP_FILTER
+    }
 #if (ENABLE_DSP_ADT_EFFECT)
-        dsp_adt(&pmem[i]);
-#endif
+    // Second track from the left channel, processed as a block
+    uint32_t adt_frames = MIN((size / CHANNELS_NUMBER), DATA_BUFFER_SIZE);
+
+    for (uint32_t i = 0; i < adt_frames; i++)
+    {
+        adt_in[i] = pmem[2 * i];
     }
+    dsp_adt(adt_in, pmem, adt_frames);
+#endif // ENABLE_DSP_ADT_EFFECT
+#endif // ENABLE_STEREO_DIFF
 #endif // ENABLE_SIGNAL_GEN
+
+    dsp_prof_stop(DSP_PROF_CHAIN);
+
+#if (ENABLE_DITHER)
+    // Reduction to the 16 bit window considered by the bt module
+    dsp_prof_start(DSP_PROF_DITHER);
+    dither_process(pmem, (size / CHANNELS_NUMBER));
+    dsp_prof_stop(DSP_PROF_DITHER);
+#endif // ENABLE_DITHER
+
+#if (ENABLE_LATENCY_MEAS)
+    // Block ready for the TX queue
+    latency_process_output();
+#endif // ENABLE_LATENCY_MEAS
+
+    dsp_prof_stop(DSP_PROF_ELAB);
 }
 
-static uint16_t bt_peer_select(const struct bluetooth_peers *peers, const int16_t *size)
+/**
+ * @brief bt_event
+ *
+ * @param evt
+ */
+static void bt_event(enum bluetooth_drv_evt_e evt)
 {
-    uint8_t peer_idex = 0;
-    uint8_t peers_n = 0;
+    switch (evt)
+    {
+    case BT_EVT_SCANNING:
+        peer_select_start();
+        break;
+    case BT_EVT_CONNECTED:
+        peer_select_result(true);
+        break;
+    case BT_EVT_CONN_FAILED:
+        peer_select_result(false);
+        break;
+    default:
+        break;
+    }
+}
 
-    while (set == 0)
+/**
+ * @brief bt_link_event
+ *
+ * @param evt
+ */
+static void bt_link_event(const struct bluetooth_drv_link_evt *evt)
+{
+    switch (evt->type)
     {
-        peers_n = *size;
+    case BT_LINK_EVT_DOWN:
+        atomic_set(&bt_link_lost, 1);
+        break;
+    case BT_LINK_EVT_UP:
+        atomic_set(&bt_link_lost, 0);
+        break;
+    default:
+        break;
+    }
+}
 
-        // Set a string to be shown onto the display
-        display_drv_strToShow(peers[0].name);
-        display_drv_event_set(SHOW_STRING);
+/**
+ * @brief inputs_notify; runs on the keypad thread, events are handled on the system workqueue
+ *
+ */
+static void inputs_notify(void)
+{
+    k_work_submit(&inputs_work);
+}
 
-        k_sleep(K_MSEC(300)); // Gives time to the bluetooth thread to check for other peers
+/**
+ * @brief inputs_work_handler
+ *
+ * @param work
+ */
+static void inputs_work_handler(struct k_work *work)
+{
+    struct keypad_drv_evt evt;
 
-        if (right)
-        {
-            right = 0;
-            peer_idex = ((peer_idex + 1) % peers_n);
-        }
-        else if (left)
-        {
-            left = 0;
-            peer_idex = (peer_idex == 0) ? (peers_n - 1) : (peer_idex - 1);
-        }
+    while (keypad_drv_evt_get(&evt, K_NO_WAIT) == 0)
+    {
+        inputs_handler_cb(&evt);
     }
-
-    set = 0;
-
-    return peer_idex;
 }
 
 /**
  * @brief inputs_handler_cb
  *
+ * @param evt
  */
-static void inputs_handler_cb(void)
+static void inputs_handler_cb(const struct keypad_drv_evt *evt)
 {
-    enum buttons_e inputs_state = keypad_drv_btn_read();
-    right = 0;
-    left = 0;
-    set = 0;
+    if (evt->type == KEYPAD_EVT_RELEASE)
+    {
+        if (evt->pressed == 0)
+        {
+            keypad_drv_led_clear(255);
+        }
+        return;
+    }
 
-    switch (inputs_state)
+#if (ENABLE_DSP_ADT_EFFECT)
+    if ((evt->type == KEYPAD_EVT_PRESS) &&
+        ((evt->pressed == INPUTS_CHORD_PAR_RESET) || (evt->pressed == INPUTS_CHORD_ALL_RESET)) &&
+        (peer_select_get_state() == PEER_SELECT_IDLE))
+    {
+        param_edit_reset(evt->pressed == INPUTS_CHORD_ALL_RESET);
+        adt_page_show();
+        display_stb_timer = k_uptime_get();
+        return;
+    }
+#endif // ENABLE_DSP_ADT_EFFECT
+
+    // Held buttons act only alone, and only the up and down ones repeat
+    if ((evt->type != KEYPAD_EVT_PRESS) &&
+        (((evt->pressed & (evt->pressed - 1)) != 0) || ((evt->btn != BUTTON_1) && (evt->btn != BUTTON_2))))
+    {
+        return;
+    }
+
+    switch (evt->btn)
     {
     case BUTTON_1:
         keypad_drv_led_set(LED_1);
-        right = 1;
-        audio_effects_handler.adt_set.EnDis = 0;
-        audio_effects_handler.adt_set.delay = 5;
-        audio_effects_handler.adt_set.fading_lev = 0;
-        pages_adt_page(audio_effects_handler.adt_set, 0);
+        if (peer_select_button(PEER_SELECT_NEXT) == 0)
+        {
+            display_stb_timer = k_uptime_get();
+            break;
+        }
+#if (ENABLE_DSP_ADT_EFFECT)
+        param_edit_step(1, evt->held_ms);
+        adt_page_show();
+#endif // ENABLE_DSP_ADT_EFFECT
         // Reset the timer
         display_stb_timer = k_uptime_get();
         break;
     case BUTTON_2:
-        left = 1;
-        audio_effects_handler.adt_set.EnDis = 0;
-        audio_effects_handler.adt_set.delay = 5;
-        audio_effects_handler.adt_set.fading_lev = 0;
-        pages_adt_page(audio_effects_handler.adt_set, 1);
+        if (peer_select_button(PEER_SELECT_PREV) == 0)
+        {
+            display_stb_timer = k_uptime_get();
+            break;
+        }
+#if (ENABLE_DSP_ADT_EFFECT)
+        param_edit_step(-1, evt->held_ms);
+        adt_page_show();
+#endif // ENABLE_DSP_ADT_EFFECT
         // Reset the timer
         display_stb_timer = k_uptime_get();
         break;
     case BUTTON_3:
-        set = 1;
-        audio_effects_handler.adt_set.EnDis = 0;
-        audio_effects_handler.adt_set.delay = 5;
-        audio_effects_handler.adt_set.fading_lev = 0;
-        pages_adt_page(audio_effects_handler.adt_set, 2);
+        if (peer_select_button(PEER_SELECT_OK) == 0)
+        {
+            display_stb_timer = k_uptime_get();
+            break;
+        }
+#if (ENABLE_DSP_ADT_EFFECT)
+        param_edit_select_next();
+        adt_page_show();
+#endif // ENABLE_DSP_ADT_EFFECT
         // Reset the timer
         display_stb_timer = k_uptime_get();
         break;
+#if (ENABLE_DSP_ADT_EFFECT)
     case BUTTON_4:
-        audio_effects_handler.adt_set.EnDis = 1;
-        audio_effects_handler.adt_set.delay = 5;
-        audio_effects_handler.adt_set.fading_lev = 0;
-        pages_adt_page(audio_effects_handler.adt_set, 0);
+        param_edit_set(ADT_PAR_EN, !param_edit_get(ADT_PAR_EN));
+        adt_page_show();
         // Reset the timer
         display_stb_timer = k_uptime_get();
         break;
+#endif // ENABLE_DSP_ADT_EFFECT
+#if (ENABLE_LATENCY_MEAS)
+    case BUTTON_5:
+        if (latency_start() == 0)
+        {
+            keypad_drv_led_set(LED_5);
+        }
+        // Reset the timer
+        display_stb_timer = k_uptime_get();
+        break;
+#endif // ENABLE_LATENCY_MEAS
+#if (ENABLE_STEREO_DIFF)
+    case BUTTON_6:
+    {
+        struct balanced_status bal;
+
+        balanced_get_status(&bal);
+        pages_balanced_page(bal.cmrr_db, bal.cmrr_raw_db, (bal.trim_l_ppm / 1000), (bal.trim_r_ppm / 1000));
+        // Reset the timer
+        display_stb_timer = k_uptime_get();
+        break;
+    }
+#endif // ENABLE_STEREO_DIFF
+    case BUTTON_7:
+    {
+        struct boot_stage_stats ui;
+        struct boot_stage_stats bt = {0};
+
+        boot_get_stats(BOOT_KEYPAD, &ui); // Display and keypad ready
+#if (!DEBUG_MODE)
+        boot_get_stats(BOOT_BT, &bt);
+#endif // DEBUG_MODE
+        pages_boot_page(boot_get_audio_us() / 1000, ui.end_us / 1000, bt.end_us / 1000, boot_get_done_us() / 1000);
+        // Reset the timer
+        display_stb_timer = k_uptime_get();
+        break;
+    }
     default:
-        keypad_drv_led_clear(255);
         break;
     }
 }
 
+#if (ENABLE_LATENCY_MEAS)
+/**
+ * @brief latency_done
+ *
+ * @param res
+ */
+static void latency_done(const struct latency_result *res)
+{
+    printk("Latency: processing %d us, I2S queues %d us, loopback %d us\n", res->proc_us, res->io_us, res->loop_us);
+    pages_latency_page(res->proc_us, res->loop_us, res->io_us);
+    display_stb_timer = k_uptime_get();
+}
+#endif // ENABLE_LATENCY_MEAS
+
 /**
  * @brief idle_hook
  *
@@ -1,11 +1,16 @@
 
 #include "pages.h"
 
+#include <zephyr/sys/util.h>
+
 #include <string.h>
 #include <stdio.h>
 
 #include "display_drv.h"
 
+#define PAGES_CMRR_FULL_DB 60 // CMRR shown as a full meter
+#define PAGES_BOOT_AUDIO_TARGET_MS 300 // Time-to-audio budget, shown as a full bar
+
 /**
  * @brief pages_demo_page
  *
@@ -13,25 +18,29 @@
  */
 void pages_demo_page(uint8_t EnDis, uint8_t idx, int v1, int v2, int v3, int v4)
 {
-        display_pages_t page;
+        display_pages_t *page = display_drv_page_alloc();
+
+        if (page == NULL)
+        {
+                return; // Display busy, the next update shows the current values
+        }
 
-        strcpy(page.title, "DEMO");
+        strcpy(page->title, "DEMO");
 
-        page.EnDis = EnDis;
+        page->EnDis = EnDis;
 
-        strcpy(page.par[0].title, "PAR1");
-        strcpy(page.par[1].title, "PAR2");
-        strcpy(page.par[2].title, "PAR3");
-        strcpy(page.par[3].title, "PAR4");
+        strcpy(page->par[0].title, "PAR1");
+        strcpy(page->par[1].title, "PAR2");
+        strcpy(page->par[2].title, "PAR3");
+        strcpy(page->par[3].title, "PAR4");
 
-        snprintf(page.par[0].val, sizeof(page.par[0].val), "%d", v1);
-        snprintf(page.par[1].val, sizeof(page.par[1].val), "%d", v2);
-        snprintf(page.par[2].val, sizeof(page.par[2].val), "%d", v3);
-        snprintf(page.par[3].val, sizeof(page.par[3].val), "%d", v4);
+        snprintf(page->par[0].val, sizeof(page->par[0].val), "%d", v1);
+        snprintf(page->par[1].val, sizeof(page->par[1].val), "%d", v2);
+        snprintf(page->par[2].val, sizeof(page->par[2].val), "%d", v3);
+        snprintf(page->par[3].val, sizeof(page->par[3].val), "%d", v4);
 
-        page.par_select = idx;
-        display_drv_pageToShow(page);
-        display_drv_event_set(SHOW_PAGE);
+        page->par_select = idx;
+        display_drv_page_show(page);
 }
 
 /**
@@ -42,23 +51,143 @@ void pages_demo_page(uint8_t EnDis, uint8_t idx, int v1, int v2, int v3, int v4)
  */
 void pages_adt_page(struct adt_settings adt_set, uint8_t idx)
 {
-        display_pages_t page;
+        display_pages_t *page = display_drv_page_alloc();
 
-        strcpy(page.title, "ADT");
+        if (page == NULL)
+        {
+                return; // Display busy, the next update shows the current values
+        }
 
-        page.EnDis = adt_set.EnDis;
+        strcpy(page->title, "ADT");
 
-        strcpy(page.par[0].title, "DEL");
-        strcpy(page.par[1].title, "AMP");
-        strcpy(page.par[2].title, "");
-        strcpy(page.par[3].title, "");
+        page->EnDis = adt_set.EnDis;
 
-        snprintf(page.par[0].val, sizeof(page.par[0].val), "%d", adt_set.delay);
-        snprintf(page.par[1].val, sizeof(page.par[1].val), "%d", adt_set.fading_lev);
-        snprintf(page.par[2].val, sizeof(page.par[2].val), "%c", '\0');
-        snprintf(page.par[3].val, sizeof(page.par[3].val), "%c", '\0');
+        strcpy(page->par[0].title, "DEL");
+        strcpy(page->par[1].title, "AMP");
+        strcpy(page->par[2].title, "");
+        strcpy(page->par[3].title, "");
+
+        snprintf(page->par[0].val, sizeof(page->par[0].val), "%d", adt_set.delay);
+        snprintf(page->par[1].val, sizeof(page->par[1].val), "%d", adt_set.fading_lev);
+        snprintf(page->par[2].val, sizeof(page->par[2].val), "%c", '\0');
+        snprintf(page->par[3].val, sizeof(page->par[3].val), "%c", '\0');
+
+        page->par_select = idx;
+        display_drv_page_show(page);
+}
+
+/**
+ * @brief pages_latency_page
+ *
+ * @param proc_us
+ * @param loop_us negative if not measured
+ * @param io_us I2S queues
+ */
+void pages_latency_page(int32_t proc_us, int32_t loop_us, int32_t io_us)
+{
+        display_pages_t *page = display_drv_page_alloc();
+        int32_t val[3] = {proc_us, loop_us, io_us};
 
-        page.par_select = idx;
-        display_drv_pageToShow(page);
-        display_drv_event_set(SHOW_PAGE);
-}
\ No newline at end of file
+        if (page == NULL)
+        {
+                return; // Display busy, the next update shows the current values
+        }
+
+        strcpy(page->title, "LAT");
+
+        page->EnDis = 1;
+
+        strcpy(page->par[0].title, "PROC");
+        strcpy(page->par[1].title, "LOOP");
+        strcpy(page->par[2].title, "I2S");
+        strcpy(page->par[3].title, "");
+
+        // Values in ms, one decimal digit
+        for (int i = 0; i < 3; i++)
+        {
+                if (val[i] < 0)
+                {
+                        snprintf(page->par[i].val, sizeof(page->par[i].val), "--");
+                }
+                else
+                {
+                        snprintf(page->par[i].val, sizeof(page->par[i].val), "%d.%d", (int)(val[i] / 1000), (int)((val[i] % 1000) / 100));
+                }
+        }
+        snprintf(page->par[3].val, sizeof(page->par[3].val), "%c", '\0');
+
+        page->par_select = 0;
+        display_drv_page_show(page);
+}
+
+/**
+ * @brief pages_balanced_page
+ *
+ * @param cmrr_db rejection with the gain trim
+ * @param raw_db rejection before the gain trim
+ * @param trim_l left leg trim in 0.1%
+ * @param trim_r right leg trim in 0.1%
+ */
+void pages_balanced_page(int16_t cmrr_db, int16_t raw_db, int32_t trim_l, int32_t trim_r)
+{
+        display_pages_t *page = display_drv_page_alloc();
+
+        if (page == NULL)
+        {
+                return; // Display busy, the next update shows the current values
+        }
+
+        strcpy(page->title, "BAL");
+
+        page->EnDis = 1;
+
+        strcpy(page->par[0].title, "CMRR");
+        strcpy(page->par[1].title, "RAW");
+        strcpy(page->par[2].title, "TRML");
+        strcpy(page->par[3].title, "TRMR");
+
+        snprintf(page->par[0].val, sizeof(page->par[0].val), "%d", cmrr_db);
+        snprintf(page->par[1].val, sizeof(page->par[1].val), "%d", raw_db);
+        snprintf(page->par[2].val, sizeof(page->par[2].val), "%d", (int)trim_l);
+        snprintf(page->par[3].val, sizeof(page->par[3].val), "%d", (int)trim_r);
+        page->meter = (int8_t)CLAMP(((cmrr_db * 100) / PAGES_CMRR_FULL_DB), 0, 100);
+
+        page->par_select = 0;
+        display_drv_page_show(page);
+}
+
+/**
+ * @brief pages_boot_page; boot milestones from power-on
+ *
+ * @param audio_ms first processed audio block
+ * @param ui_ms display and keypad ready
+ * @param bt_ms BT module configured
+ * @param done_ms every stage done
+ */
+void pages_boot_page(uint32_t audio_ms, uint32_t ui_ms, uint32_t bt_ms, uint32_t done_ms)
+{
+        display_pages_t *page = display_drv_page_alloc();
+
+        if (page == NULL)
+        {
+                return; // Display busy, the next update shows the current values
+        }
+
+        strcpy(page->title, (audio_ms > PAGES_BOOT_AUDIO_TARGET_MS) ? "BOOT SLOW" : "BOOT");
+
+        page->EnDis = 1;
+
+        strcpy(page->par[0].title, "AUD");
+        strcpy(page->par[1].title, "UI");
+        strcpy(page->par[2].title, "BT");
+        strcpy(page->par[3].title, "ALL");
+
+        snprintf(page->par[0].val, sizeof(page->par[0].val), "%u", (unsigned int)audio_ms);
+        snprintf(page->par[1].val, sizeof(page->par[1].val), "%u", (unsigned int)ui_ms);
+        snprintf(page->par[2].val, sizeof(page->par[2].val), "%u", (unsigned int)bt_ms);
+        snprintf(page->par[3].val, sizeof(page->par[3].val), "%u", (unsigned int)done_ms);
+        page->bar = (audio_ms > 0) ? (int8_t)MIN(((audio_ms * 100) / PAGES_BOOT_AUDIO_TARGET_MS), 100) : -1; // Time-to-audio against the budget
+
+        page->par_select = 0;
+        display_drv_page_show(page);
+}
@@ -7,7 +7,7 @@
 struct adt_settings
 {
     uint8_t EnDis;
-    uint8_t delay;
+    uint16_t delay; // ms
     uint8_t fading_lev;
 };
 typedef struct 
@@ -17,5 +17,8 @@ typedef struct
 
 void pages_demo_page(uint8_t EnDis, uint8_t idx, int v1, int v2, int v3, int v4);
 void pages_adt_page(struct adt_settings adt_set, uint8_t idx);
+void pages_latency_page(int32_t proc_us, int32_t loop_us, int32_t io_us);
+void pages_balanced_page(int16_t cmrr_db, int16_t raw_db, int32_t trim_l, int32_t trim_r);
+void pages_boot_page(uint32_t audio_ms, uint32_t ui_ms, uint32_t bt_ms, uint32_t done_ms);
 
 #endif // PAGES_H
\ No newline at end of file
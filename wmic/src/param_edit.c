@@ -0,0 +1,166 @@
+/*
+ * Parameter editor
+ * Keypad driven edits of a parameters table, applied through its callback
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "param_edit.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+struct param_edit_handler_t
+{
+    const struct param_edit_cfg *cfg;
+    int16_t val[PARAM_EDIT_MAX_PARS];
+    uint8_t sel;
+} static param_edit_handler;
+
+// Step multipliers, one more every PARAM_EDIT_ACCEL_MS of hold
+static const int16_t param_edit_accel[] = {1, 5, 20};
+
+static void param_edit_apply(void);
+
+/**
+ * @brief param_edit_init; load the defaults and apply them
+ *
+ * Not thread safe with the edits: call it before the inputs are delivered,
+ * the apply callback has a single caller at any time.
+ *
+ * @param cfg parameters table, must stay valid
+ * @return int
+ */
+int param_edit_init(const struct param_edit_cfg *cfg)
+{
+    if ((cfg->par_num == 0) || (cfg->par_num > PARAM_EDIT_MAX_PARS))
+    {
+        return -1;
+    }
+
+    param_edit_handler.cfg = cfg;
+    param_edit_handler.sel = 0;
+    param_edit_reset(true);
+
+    return 0;
+}
+
+/**
+ * @brief param_edit_get
+ *
+ * @param idx
+ * @return int16_t
+ */
+int16_t param_edit_get(uint8_t idx)
+{
+    return param_edit_handler.val[idx];
+}
+
+/**
+ * @brief param_edit_selected
+ *
+ * @return uint8_t
+ */
+uint8_t param_edit_selected(void)
+{
+    return param_edit_handler.sel;
+}
+
+/**
+ * @brief param_edit_select_next; wraps around
+ *
+ */
+void param_edit_select_next(void)
+{
+    if (param_edit_handler.cfg == NULL)
+    {
+        return; // No parameters table, the effect is not built in
+    }
+
+    param_edit_handler.sel = ((param_edit_handler.sel + 1) % param_edit_handler.cfg->par_num);
+}
+
+/**
+ * @brief param_edit_step; move the selected parameter, faster the longer the button is held
+ *
+ * @param dir +1 or -1
+ * @param held_ms time since the press, 0 for a single press
+ * @return bool true if the value changed
+ */
+bool param_edit_step(int dir, uint32_t held_ms)
+{
+    if (param_edit_handler.cfg == NULL)
+    {
+        return false;
+    }
+
+    const struct param_edit_par *par = &param_edit_handler.cfg->par[param_edit_handler.sel];
+    uint32_t accel = MIN((held_ms / PARAM_EDIT_ACCEL_MS), (ARRAY_SIZE(param_edit_accel) - 1));
+    int32_t val = param_edit_handler.val[param_edit_handler.sel] + (dir * par->step * param_edit_accel[accel]);
+
+    return param_edit_set(param_edit_handler.sel, (int16_t)CLAMP(val, par->min, par->max));
+}
+
+/**
+ * @brief param_edit_set
+ *
+ * @param idx
+ * @param val clamped to the parameter range
+ * @return bool true if the value changed
+ */
+bool param_edit_set(uint8_t idx, int16_t val)
+{
+    if ((param_edit_handler.cfg == NULL) || (idx >= param_edit_handler.cfg->par_num))
+    {
+        return false;
+    }
+
+    const struct param_edit_par *par = &param_edit_handler.cfg->par[idx];
+
+    val = CLAMP(val, par->min, par->max);
+    if (val == param_edit_handler.val[idx])
+    {
+        return false;
+    }
+
+    param_edit_handler.val[idx] = val;
+    param_edit_apply();
+
+    return true;
+}
+
+/**
+ * @brief param_edit_reset; restore the defaults
+ *
+ * @param all false to reset only the selected parameter
+ */
+void param_edit_reset(bool all)
+{
+    if (param_edit_handler.cfg == NULL)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < param_edit_handler.cfg->par_num; i++)
+    {
+        if (all || (i == param_edit_handler.sel))
+        {
+            param_edit_handler.val[i] = param_edit_handler.cfg->par[i].def;
+        }
+    }
+
+    param_edit_apply();
+}
+
+/**
+ * @brief param_edit_apply
+ *
+ */
+static void param_edit_apply(void)
+{
+    if (param_edit_handler.cfg->apply != NULL)
+    {
+        param_edit_handler.cfg->apply(param_edit_handler.val);
+    }
+}
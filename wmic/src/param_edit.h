@@ -0,0 +1,37 @@
+#ifndef PARAM_EDIT_H
+#define PARAM_EDIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PARAM_EDIT_MAX_PARS 4
+#define PARAM_EDIT_ACCEL_MS 1500 // Hold time after which the step grows to the next multiplier
+
+struct param_edit_par
+{
+    const char *title;
+    int16_t min;
+    int16_t max;
+    int16_t step; // Increment of a single press
+    int16_t def;  // Value restored by a reset
+};
+
+// Called after every edit with the whole set, par_num values
+typedef void (*param_edit_apply_cb)(const int16_t *val);
+
+struct param_edit_cfg
+{
+    const struct param_edit_par *par;
+    uint8_t par_num;
+    param_edit_apply_cb apply;
+};
+
+int param_edit_init(const struct param_edit_cfg *cfg);
+int16_t param_edit_get(uint8_t idx);
+uint8_t param_edit_selected(void);
+void param_edit_select_next(void);
+bool param_edit_step(int dir, uint32_t held_ms);
+bool param_edit_set(uint8_t idx, int16_t val);
+void param_edit_reset(bool all);
+
+#endif // PARAM_EDIT_H
@@ -0,0 +1,216 @@
+/*
+ * Peer selection
+ * Scanned peers browsed from the keypad, connection requested to the BT driver
+ * The state machine runs on the system work queue, woken by the buttons and
+ * the BT events, refreshed periodically only while the list is shown
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "peer_select.h"
+
+#include <zephyr/kernel.h>
+
+#include <string.h>
+#include <stdio.h>
+
+#include "display_drv.h"
+
+#define PEER_SELECT_QUEUE_LEN 8
+#define PEER_SELECT_RESCAN_MS 10000 // Scan refresh while browsing, peers not advertised expire in the driver
+#define PEER_SELECT_REFRESH_MS 500  // List refresh while browsing, new peers from the running scan
+
+K_MSGQ_DEFINE(peer_select_msgq, sizeof(enum peer_select_btn_e), PEER_SELECT_QUEUE_LEN, 4);
+
+struct peer_select_handler_t
+{
+    atomic_t state;
+    enum peer_select_state_e shown_state;
+    struct bluetooth_peers peers[BLUETOOTH_DRV_MAX_PEERS];
+    uint16_t peers_n;
+    uint16_t sel;
+    uint8_t sel_mac[BLUETOOTH_DRV_MAC_LEN]; // Highlighted peer, followed when the list is sorted again
+    char shown[BLUETOOTH_DRV_NAME_SIZE + 10]; // Last string sent to the display
+    int64_t scan_time;
+} static peer_select_handler;
+
+static void peer_select_process(struct k_work *work);
+static void peer_select_browse(void);
+static void peer_select_show(const char *str);
+
+K_WORK_DELAYABLE_DEFINE(peer_select_work, peer_select_process);
+
+/**
+ * @brief peer_select_start; enter the peers list, called when no known peer answered
+ *
+ */
+void peer_select_start(void)
+{
+    k_msgq_purge(&peer_select_msgq);
+    atomic_set(&peer_select_handler.state, PEER_SELECT_BROWSE);
+    k_work_reschedule(&peer_select_work, K_NO_WAIT);
+}
+
+/**
+ * @brief peer_select_button; queue a button event
+ *
+ * @param btn
+ * @return int -1 if the selection is not running
+ */
+int peer_select_button(enum peer_select_btn_e btn)
+{
+    enum peer_select_state_e state = atomic_get(&peer_select_handler.state);
+
+    if ((state != PEER_SELECT_BROWSE) && (state != PEER_SELECT_CONNECTING))
+    {
+        return -1;
+    }
+
+    k_msgq_put(&peer_select_msgq, &btn, K_NO_WAIT);
+    k_work_reschedule(&peer_select_work, K_NO_WAIT);
+    return 0;
+}
+
+/**
+ * @brief peer_select_result; link outcome for the chosen peer
+ *
+ * @param connected
+ */
+void peer_select_result(bool connected)
+{
+    atomic_set(&peer_select_handler.state, (connected ? PEER_SELECT_DONE : PEER_SELECT_BROWSE));
+    k_work_reschedule(&peer_select_work, K_NO_WAIT);
+}
+
+/**
+ * @brief peer_select_get_state
+ *
+ * @return enum peer_select_state_e
+ */
+enum peer_select_state_e peer_select_get_state(void)
+{
+    return atomic_get(&peer_select_handler.state);
+}
+
+/**
+ * @brief peer_select_process; step of the selection state machine, system work queue
+ *
+ * @param work
+ */
+static void peer_select_process(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    enum peer_select_state_e state = atomic_get(&peer_select_handler.state);
+    enum peer_select_btn_e btn;
+
+    // Force a redraw on state change
+    if (state != peer_select_handler.shown_state)
+    {
+        peer_select_handler.shown_state = state;
+        peer_select_handler.shown[0] = '\0';
+    }
+
+    switch (state)
+    {
+    case PEER_SELECT_BROWSE:
+        peer_select_browse();
+        // Not rescheduled if a button or an event already queued a step
+        k_work_schedule(&peer_select_work, K_MSEC(PEER_SELECT_REFRESH_MS));
+        break;
+    case PEER_SELECT_CONNECTING:
+        k_msgq_purge(&peer_select_msgq);
+        peer_select_show("Connecting...");
+        break;
+    case PEER_SELECT_DONE:
+        peer_select_show("Connected");
+        // A new scan may have started meanwhile from the BT thread, it's kept
+        atomic_cas(&peer_select_handler.state, PEER_SELECT_DONE, PEER_SELECT_IDLE);
+        break;
+    default:
+        while (k_msgq_get(&peer_select_msgq, &btn, K_NO_WAIT) == 0)
+        {
+        }
+        break;
+    }
+}
+
+/**
+ * @brief peer_select_browse
+ *
+ */
+static void peer_select_browse(void)
+{
+    struct peer_select_handler_t *h = &peer_select_handler;
+    enum peer_select_btn_e btn;
+    char str[sizeof(h->shown)];
+
+    // Keep the scan alive while the user is browsing
+    if ((k_uptime_get() - h->scan_time) > PEER_SELECT_RESCAN_MS)
+    {
+        h->scan_time = k_uptime_get();
+        bluetooth_drv_scan();
+    }
+
+    // Live list, follow the highlighted peer
+    h->peers_n = bluetooth_drv_peers_snapshot(h->peers, BLUETOOTH_DRV_MAX_PEERS);
+    if (h->peers_n == 0)
+    {
+        k_msgq_purge(&peer_select_msgq);
+        peer_select_show("Scanning...");
+        return;
+    }
+    for (uint16_t i = 0; i < h->peers_n; i++)
+    {
+        if (memcmp(h->peers[i].mac, h->sel_mac, BLUETOOTH_DRV_MAC_LEN) == 0)
+        {
+            h->sel = i;
+            break;
+        }
+    }
+    h->sel = MIN(h->sel, (h->peers_n - 1));
+
+    while (k_msgq_get(&peer_select_msgq, &btn, K_NO_WAIT) == 0)
+    {
+        switch (btn)
+        {
+        case PEER_SELECT_NEXT:
+            h->sel = ((h->sel + 1) % h->peers_n);
+            break;
+        case PEER_SELECT_PREV:
+            h->sel = (h->sel == 0) ? (h->peers_n - 1) : (h->sel - 1);
+            break;
+        case PEER_SELECT_OK:
+            if (bluetooth_drv_connect(&h->peers[h->sel]) == 0)
+            {
+                atomic_set(&h->state, PEER_SELECT_CONNECTING);
+                k_msgq_purge(&peer_select_msgq);
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    memcpy(h->sel_mac, h->peers[h->sel].mac, BLUETOOTH_DRV_MAC_LEN);
+
+    snprintf(str, sizeof(str), "%d/%d %s", (h->sel + 1), h->peers_n, h->peers[h->sel].name);
+    peer_select_show(str);
+}
+
+/**
+ * @brief peer_select_show; update the display only if the string changed
+ *
+ * @param str
+ */
+static void peer_select_show(const char *str)
+{
+    if (strcmp(str, peer_select_handler.shown) == 0)
+    {
+        return;
+    }
+
+    strncpy(peer_select_handler.shown, str, (sizeof(peer_select_handler.shown) - 1));
+    display_drv_str_show(peer_select_handler.shown);
+}
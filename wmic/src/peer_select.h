@@ -0,0 +1,36 @@
+/*
+ * Peer selection
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#ifndef PEER_SELECT_H
+#define PEER_SELECT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bluetooth_drv.h"
+
+enum peer_select_btn_e
+{
+    PEER_SELECT_NEXT = 0,
+    PEER_SELECT_PREV,
+    PEER_SELECT_OK,
+};
+
+enum peer_select_state_e
+{
+    PEER_SELECT_IDLE = 0,   // Not selecting, buttons go to the pages
+    PEER_SELECT_BROWSE,     // Peers list shown, updated while scanning
+    PEER_SELECT_CONNECTING, // Waiting for the link to the chosen peer
+    PEER_SELECT_DONE,       // Link up
+};
+
+void peer_select_start(void);
+int peer_select_button(enum peer_select_btn_e btn);
+void peer_select_result(bool connected);
+enum peer_select_state_e peer_select_get_state(void);
+
+#endif // PEER_SELECT_H
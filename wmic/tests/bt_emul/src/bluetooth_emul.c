@@ -0,0 +1,442 @@
+/*
+ * Bluetooth module emulator
+ * Emulated module: BT1036C, AT protocol over a zephyr,uart-emul device
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "bluetooth_emul.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/serial/uart_emul.h>
+#include <zephyr/sys/printk.h>
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define BLUETOOTH_EMUL_CMD_SIZE 100
+#define BLUETOOTH_EMUL_QUEUE_LEN 8
+#define BLUETOOTH_EMUL_LINE_SIZE 120
+
+#define BLUETOOTH_EMUL_THREAD_STACK (1024)
+#define BLUETOOTH_EMUL_THREAD_PRIORITY 9
+
+// Module settings
+#define BLUETOOTH_EMUL_PROFILE_SOURCE 64
+#define BLUETOOTH_EMUL_I2SCFG_SOURCE 71
+#define BLUETOOTH_EMUL_AUTOCONN_SOURCE 64
+#define BLUETOOTH_EMUL_PROFILE_DEFAULT 32
+
+// +A2DPSTAT values
+#define BLUETOOTH_EMUL_A2DP_IDLE 1
+#define BLUETOOTH_EMUL_A2DP_CONNECTING 2
+#define BLUETOOTH_EMUL_A2DP_CONNECTED 3
+
+#define BLUETOOTH_EMUL_NO_PEER 0xFF
+
+// Command received from the driver, or event requested by the test
+struct bluetooth_emul_cmd
+{
+    char str[BLUETOOTH_EMUL_CMD_SIZE];
+    uint32_t arg;
+};
+K_MSGQ_DEFINE(bluetooth_emul_msgq, sizeof(struct bluetooth_emul_cmd), BLUETOOTH_EMUL_QUEUE_LEN, 4);
+K_THREAD_STACK_DEFINE(bluetooth_emul_stack, BLUETOOTH_EMUL_THREAD_STACK);
+
+// Emulated module state
+struct bluetooth_emul_handler_t
+{
+    const struct device *uart;
+    const struct bluetooth_emul_cfg *cfg;
+    int profile;
+    int i2scfg;
+    int autoconn;
+    int a2dpstat;
+    uint8_t connected; // Index of the connected peer
+    uint8_t last;      // Last peer connected, target of the auto reconnection
+    char cmd[BLUETOOTH_EMUL_CMD_SIZE];
+    uint16_t cmd_len;
+} static bluetooth_emul_handler;
+
+static struct k_thread bluetooth_emul_tcb;
+
+static void bluetooth_emul_thread(void *a, void *b, void *c);
+static void bluetooth_emul_tx_ready(const struct device *dev, size_t size, void *user_data);
+static void bluetooth_emul_execute(const char *cmd, uint32_t arg);
+static void bluetooth_emul_send(const char *fmt, ...);
+static int *bluetooth_emul_setting(const char *key);
+static void bluetooth_emul_restore(void);
+static void bluetooth_emul_boot(void);
+static void bluetooth_emul_scan(void);
+static void bluetooth_emul_a2dp_connect(const char *addr);
+static void bluetooth_emul_a2dp_set(int a2dpstat);
+
+/**
+ * @brief bluetooth_emul_attach; answer the driver on the emulated UART
+ *
+ * @param uart zephyr,uart-emul device, the one given to bluetooth_drv_config
+ * @param cfg
+ * @return int
+ */
+int bluetooth_emul_attach(const struct device *uart, const struct bluetooth_emul_cfg *cfg)
+{
+    if (!device_is_ready(uart) || (cfg == NULL))
+    {
+        return -1;
+    }
+
+    bluetooth_emul_handler.uart = uart;
+    bluetooth_emul_handler.cfg = cfg;
+    bluetooth_emul_handler.connected = BLUETOOTH_EMUL_NO_PEER;
+    bluetooth_emul_handler.last = BLUETOOTH_EMUL_NO_PEER;
+    bluetooth_emul_restore();
+    if (cfg->configured)
+    {
+        bluetooth_emul_handler.profile = BLUETOOTH_EMUL_PROFILE_SOURCE;
+        bluetooth_emul_handler.i2scfg = BLUETOOTH_EMUL_I2SCFG_SOURCE;
+        bluetooth_emul_handler.autoconn = BLUETOOTH_EMUL_AUTOCONN_SOURCE;
+    }
+
+    uart_emul_callback_tx_data_ready_set(uart, bluetooth_emul_tx_ready, NULL);
+
+    k_thread_create(&bluetooth_emul_tcb,
+                    bluetooth_emul_stack,
+                    BLUETOOTH_EMUL_THREAD_STACK,
+                    bluetooth_emul_thread,
+                    NULL, NULL, NULL,
+                    BLUETOOTH_EMUL_THREAD_PRIORITY, 0, K_NO_WAIT);
+
+    printk("BT emulator attached, %d peers\n", cfg->peer_num);
+    return 0;
+}
+
+/**
+ * @brief bluetooth_emul_inject; raw bytes to the driver, e.g. line bursts or corrupted data
+ *
+ * @param raw
+ * @param len
+ * @return int
+ */
+int bluetooth_emul_inject(const char *raw, size_t len)
+{
+    return (uart_emul_put_rx_data(bluetooth_emul_handler.uart, (const uint8_t *)raw, len) == len) ? 0 : -1;
+}
+
+/**
+ * @brief bluetooth_emul_link_drop; lose the A2DP link, AUTOCONN brings it back after down_ms
+ *
+ * @param down_ms
+ * @return int
+ */
+int bluetooth_emul_link_drop(uint32_t down_ms)
+{
+    struct bluetooth_emul_cmd msg = {.str = "#DROP", .arg = down_ms};
+
+    return k_msgq_put(&bluetooth_emul_msgq, &msg, K_NO_WAIT);
+}
+
+/**
+ * @brief bluetooth_emul_thread; the module, one command at a time
+ *
+ * @param a
+ * @param b
+ * @param c
+ */
+static void bluetooth_emul_thread(void *a, void *b, void *c)
+{
+    struct bluetooth_emul_cmd msg;
+
+    while (1)
+    {
+        k_msgq_get(&bluetooth_emul_msgq, &msg, K_FOREVER);
+        k_sleep(K_MSEC(bluetooth_emul_handler.cfg->resp_ms));
+        bluetooth_emul_execute(msg.str, msg.arg);
+    }
+}
+
+/**
+ * @brief bluetooth_emul_tx_ready; collect the driver bytes into AT+ commands
+ *
+ * @param dev
+ * @param size
+ * @param user_data
+ */
+static void bluetooth_emul_tx_ready(const struct device *dev, size_t size, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    uint8_t c;
+
+    while (uart_emul_get_tx_data(dev, &c, 1) == 1)
+    {
+        if (c == '\n')
+        {
+            struct bluetooth_emul_cmd msg = {0};
+            uint16_t len = bluetooth_emul_handler.cmd_len;
+
+            // Trailing \r and AT+ prefix excluded
+            if ((len > 0) && (bluetooth_emul_handler.cmd[len - 1] == '\r'))
+            {
+                len--;
+            }
+            if ((len >= 3) && (strncmp(bluetooth_emul_handler.cmd, "AT+", 3) == 0))
+            {
+                memcpy(msg.str, &bluetooth_emul_handler.cmd[3], (len - 3));
+                if (k_msgq_put(&bluetooth_emul_msgq, &msg, K_NO_WAIT) != 0)
+                {
+                    printk("BT emulator busy, %s dropped\n", msg.str);
+                }
+            }
+            bluetooth_emul_handler.cmd_len = 0;
+        }
+        else if (bluetooth_emul_handler.cmd_len < (BLUETOOTH_EMUL_CMD_SIZE - 1))
+        {
+            bluetooth_emul_handler.cmd[bluetooth_emul_handler.cmd_len++] = c;
+        }
+    }
+}
+
+/**
+ * @brief bluetooth_emul_execute
+ *
+ * @param cmd KEY or KEY=value, AT+ excluded
+ * @param arg
+ */
+static void bluetooth_emul_execute(const char *cmd, uint32_t arg)
+{
+    const struct bluetooth_emul_cfg *cfg = bluetooth_emul_handler.cfg;
+    const char *eq = strchr(cmd, '=');
+    const char *val = (eq != NULL) ? (eq + 1) : NULL;
+    char key[16] = {0};
+    int *setting;
+
+    strncpy(key, cmd, MIN(((eq != NULL) ? (size_t)(eq - cmd) : strlen(cmd)), (sizeof(key) - 1)));
+
+    if (strcmp(key, "#DROP") == 0)
+    {
+        if (bluetooth_emul_handler.connected == BLUETOOTH_EMUL_NO_PEER)
+        {
+            return;
+        }
+        bluetooth_emul_handler.connected = BLUETOOTH_EMUL_NO_PEER;
+        bluetooth_emul_a2dp_set(BLUETOOTH_EMUL_A2DP_IDLE);
+        if (bluetooth_emul_handler.autoconn != 0)
+        {
+            k_sleep(K_MSEC(arg));
+            bluetooth_emul_a2dp_set(BLUETOOTH_EMUL_A2DP_CONNECTING);
+            bluetooth_emul_handler.connected = bluetooth_emul_handler.last;
+            bluetooth_emul_a2dp_set(BLUETOOTH_EMUL_A2DP_CONNECTED);
+        }
+    }
+    else if ((setting = bluetooth_emul_setting(key)) != NULL)
+    {
+        if (val == NULL)
+        {
+            bluetooth_emul_send("+%s=%d", key, *setting);
+        }
+        else
+        {
+            *setting = atoi(val);
+        }
+        bluetooth_emul_send("OK");
+    }
+    else if ((strcmp(key, "NAME") == 0) && (val == NULL))
+    {
+        bluetooth_emul_send("+NAME=%s", cfg->name);
+        bluetooth_emul_send("OK");
+    }
+    else if ((strcmp(key, "A2DPSTAT") == 0) && (val == NULL))
+    {
+        bluetooth_emul_send("+A2DPSTAT=%d", bluetooth_emul_handler.a2dpstat);
+        bluetooth_emul_send("OK");
+    }
+    else if ((strcmp(key, "RSSI") == 0) && (bluetooth_emul_handler.connected != BLUETOOTH_EMUL_NO_PEER))
+    {
+        int8_t rssi = cfg->peer[bluetooth_emul_handler.connected].rssi;
+
+        if (cfg->layout == BT_EMUL_LAYOUT_ADDR_FIRST)
+        {
+            bluetooth_emul_send("+RSSI=0,%d", rssi);
+        }
+        else
+        {
+            bluetooth_emul_send("+RSSI=%d", rssi);
+        }
+        bluetooth_emul_send("OK");
+    }
+    else if (strcmp(key, "RESTORE") == 0)
+    {
+        bluetooth_emul_send("OK");
+        bluetooth_emul_restore();
+        bluetooth_emul_boot();
+    }
+    else if (strcmp(key, "REBOOT") == 0)
+    {
+        bluetooth_emul_send("OK");
+        bluetooth_emul_boot();
+    }
+    else if ((strcmp(key, "SCAN") == 0) && (val != NULL))
+    {
+        bluetooth_emul_send("OK");
+        if (atoi(val) == 1)
+        {
+            bluetooth_emul_scan();
+        }
+    }
+    else if ((strcmp(key, "A2DPCONN") == 0) && (val != NULL) && (bluetooth_emul_handler.profile == BLUETOOTH_EMUL_PROFILE_SOURCE))
+    {
+        bluetooth_emul_send("OK");
+        bluetooth_emul_a2dp_connect(val);
+    }
+    else if (((strcmp(key, "AUDROUTE") == 0) || (strcmp(key, "PAIR") == 0)) && (val != NULL))
+    {
+        bluetooth_emul_send("OK");
+    }
+    else
+    {
+        bluetooth_emul_send("ERROR");
+    }
+}
+
+/**
+ * @brief bluetooth_emul_send; one \r\n framed line to the driver
+ *
+ * @param fmt
+ * @param ...
+ */
+static void bluetooth_emul_send(const char *fmt, ...)
+{
+    char line[BLUETOOTH_EMUL_LINE_SIZE];
+    va_list args;
+    int len;
+
+    strcpy(line, "\r\n");
+    va_start(args, fmt);
+    len = vsnprintf(&line[2], (sizeof(line) - 4), fmt, args);
+    va_end(args);
+
+    len = MIN((len + 2), (int)(sizeof(line) - 3));
+    strcpy(&line[len], "\r\n");
+
+    bluetooth_emul_inject(line, (len + 2));
+}
+
+/**
+ * @brief bluetooth_emul_setting; integer setting stored in the module flash
+ *
+ * @param key
+ * @return int* NULL if the key is not a setting
+ */
+static int *bluetooth_emul_setting(const char *key)
+{
+    if (strcmp(key, "PROFILE") == 0)
+    {
+        return &bluetooth_emul_handler.profile;
+    }
+    if (strcmp(key, "I2SCFG") == 0)
+    {
+        return &bluetooth_emul_handler.i2scfg;
+    }
+    if (strcmp(key, "AUTOCONN") == 0)
+    {
+        return &bluetooth_emul_handler.autoconn;
+    }
+    return NULL;
+}
+
+/**
+ * @brief bluetooth_emul_restore; factory settings
+ *
+ */
+static void bluetooth_emul_restore(void)
+{
+    bluetooth_emul_handler.profile = BLUETOOTH_EMUL_PROFILE_DEFAULT;
+    bluetooth_emul_handler.i2scfg = 0;
+    bluetooth_emul_handler.autoconn = 0;
+}
+
+/**
+ * @brief bluetooth_emul_boot; restart, the link is lost and the banner announces the module
+ *
+ */
+static void bluetooth_emul_boot(void)
+{
+    bluetooth_emul_handler.connected = BLUETOOTH_EMUL_NO_PEER;
+    bluetooth_emul_handler.a2dpstat = 0;
+
+    k_sleep(K_MSEC(bluetooth_emul_handler.cfg->boot_ms));
+    bluetooth_emul_send("+VER=BT1036C_EMUL");
+    bluetooth_emul_send("+NAME=%s", bluetooth_emul_handler.cfg->name);
+}
+
+/**
+ * @brief bluetooth_emul_scan; one +SCAN record per peer
+ *
+ */
+static void bluetooth_emul_scan(void)
+{
+    const struct bluetooth_emul_cfg *cfg = bluetooth_emul_handler.cfg;
+
+    for (uint8_t i = 0; i < cfg->peer_num; i++)
+    {
+        const struct bluetooth_emul_peer *peer = &cfg->peer[i];
+
+        k_sleep(K_MSEC(cfg->scan_ms));
+        if (cfg->layout == BT_EMUL_LAYOUT_ADDR_FIRST)
+        {
+            bluetooth_emul_send("+SCAN=%s,%s,%d", peer->addr, peer->name, peer->rssi);
+        }
+        else
+        {
+            bluetooth_emul_send("+SCAN=0,%d,%d,%s,%s", (i + 1), peer->rssi, peer->addr, peer->name);
+        }
+    }
+}
+
+/**
+ * @brief bluetooth_emul_a2dp_connect; connecting state, then the outcome after connect_ms
+ *
+ * @param addr
+ */
+static void bluetooth_emul_a2dp_connect(const char *addr)
+{
+    const struct bluetooth_emul_cfg *cfg = bluetooth_emul_handler.cfg;
+    uint8_t peer = BLUETOOTH_EMUL_NO_PEER;
+
+    for (uint8_t i = 0; i < cfg->peer_num; i++)
+    {
+        if (strcmp(cfg->peer[i].addr, addr) == 0) // Exact match, a reformatted address is an unknown peer
+        {
+            peer = i;
+            break;
+        }
+    }
+
+    bluetooth_emul_a2dp_set(BLUETOOTH_EMUL_A2DP_CONNECTING);
+    k_sleep(K_MSEC(cfg->connect_ms));
+
+    if ((peer != BLUETOOTH_EMUL_NO_PEER) && cfg->peer[peer].reachable)
+    {
+        bluetooth_emul_handler.connected = peer;
+        bluetooth_emul_handler.last = peer;
+        bluetooth_emul_a2dp_set(BLUETOOTH_EMUL_A2DP_CONNECTED);
+    }
+    else
+    {
+        bluetooth_emul_a2dp_set(BLUETOOTH_EMUL_A2DP_IDLE);
+    }
+}
+
+/**
+ * @brief bluetooth_emul_a2dp_set; status change, reported unsolicited
+ *
+ * @param a2dpstat
+ */
+static void bluetooth_emul_a2dp_set(int a2dpstat)
+{
+    bluetooth_emul_handler.a2dpstat = a2dpstat;
+    bluetooth_emul_send("+A2DPSTAT=%d", a2dpstat);
+}
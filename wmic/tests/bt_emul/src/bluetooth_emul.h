@@ -0,0 +1,42 @@
+#ifndef BLUETOOTH_EMUL_H
+#define BLUETOOTH_EMUL_H
+
+#include <zephyr/device.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fields order of the +SCAN and +RSSI records. The module documentation at hand
+// doesn't show them, the driver must cope with both.
+enum bluetooth_emul_layout_e
+{
+    BT_EMUL_LAYOUT_INDEX_FIRST = 0, // +SCAN=0,<n>,<rssi>,<addr>,<name> +RSSI=<rssi>
+    BT_EMUL_LAYOUT_ADDR_FIRST,      // +SCAN=<addr>,<name>,<rssi>       +RSSI=<link>,<rssi>
+};
+
+struct bluetooth_emul_peer
+{
+    const char *addr; // As advertised, A2DPCONN must send it back unchanged
+    int8_t rssi;     // dBm
+    const char *name;
+    bool reachable; // A2DPCONN succeeds
+};
+
+struct bluetooth_emul_cfg
+{
+    const char *name;    // +NAME banner
+    uint32_t resp_ms;    // Delay before answering a command
+    uint32_t boot_ms;    // RESTORE/REBOOT to +NAME banner
+    uint32_t connect_ms; // A2DPCONN to the final +A2DPSTAT
+    uint32_t scan_ms;    // Interval between +SCAN records
+    bool configured;     // Source settings already stored in the module flash
+    enum bluetooth_emul_layout_e layout; // Read at every record, may change while running
+    const struct bluetooth_emul_peer *peer;
+    uint8_t peer_num;
+};
+
+int bluetooth_emul_attach(const struct device *uart, const struct bluetooth_emul_cfg *cfg);
+int bluetooth_emul_inject(const char *raw, size_t len);
+int bluetooth_emul_link_drop(uint32_t down_ms);
+
+#endif // BLUETOOTH_EMUL_H
@@ -0,0 +1,304 @@
+/*
+ * BT driver against the module emulator
+ * Boot configuration, scan, refused and accepted connections, link quality
+ * poll, link loss and raw line injection, with their timings
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "bluetooth_drv.h"
+#include "bluetooth_emul.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/settings/settings.h>
+
+#include <string.h>
+
+// Emulated module timings
+#define EMUL_RESP_MS 5
+#define EMUL_BOOT_MS 800
+#define EMUL_CONNECT_MS 1500
+#define EMUL_SCAN_MS 200
+#define EMUL_DROP_MS 300
+
+#define BOOT_CMDS 7         // NAME, first query, RESTORE, three settings and REBOOT
+#define LINK_POLL_MS 2000   // As the driver
+#define SLACK_MS 50         // Thread hops and AT round trips on top of the emulated delays
+#define EVT_QUEUE_LEN 8
+
+// Peers in RSSI order. Address formats differ, A2DPCONN must send each one back
+// as advertised. The last name reads like an RSSI to a parser going by position.
+static const struct bluetooth_emul_peer emul_peers[] = {
+    {.addr = "0C1D2E3F4A5B", .rssi = -48, .name = "EMUL_FAR", .reachable = false},
+    {.addr = "A1:B2:C3:D4:E5:F6", .rssi = -62, .name = "EMUL_SPK", .reachable = true},
+    {.addr = "11-22-33-44-55-66", .rssi = -80, .name = "-7 HP", .reachable = true},
+};
+
+static struct bluetooth_emul_cfg emul_cfg = {
+    .name = "WMIC_EMUL",
+    .resp_ms = EMUL_RESP_MS,
+    .boot_ms = EMUL_BOOT_MS,
+    .connect_ms = EMUL_CONNECT_MS,
+    .scan_ms = EMUL_SCAN_MS,
+    .configured = false,
+    .layout = BT_EMUL_LAYOUT_INDEX_FIRST,
+    .peer = emul_peers,
+    .peer_num = ARRAY_SIZE(emul_peers),
+};
+
+static const struct device *const uart = DEVICE_DT_GET(DT_NODELABEL(bt_emul_uart));
+
+K_MSGQ_DEFINE(drv_evt_msgq, sizeof(enum bluetooth_drv_evt_e), EVT_QUEUE_LEN, 4);
+K_MSGQ_DEFINE(link_evt_msgq, sizeof(struct bluetooth_drv_link_evt), EVT_QUEUE_LEN, 4);
+
+static void on_drv_evt(enum bluetooth_drv_evt_e evt)
+{
+    k_msgq_put(&drv_evt_msgq, &evt, K_NO_WAIT);
+}
+
+static void on_link_evt(const struct bluetooth_drv_link_evt *evt)
+{
+    k_msgq_put(&link_evt_msgq, evt, K_NO_WAIT);
+}
+
+/**
+ * @brief drv_evt_expect; next driver event, within the timeout
+ *
+ * @param expected
+ * @param timeout_ms
+ */
+static void drv_evt_expect(enum bluetooth_drv_evt_e expected, uint32_t timeout_ms)
+{
+    enum bluetooth_drv_evt_e evt;
+
+    zassert_ok(k_msgq_get(&drv_evt_msgq, &evt, K_MSEC(timeout_ms)), "no driver event within %u ms", timeout_ms);
+    zassert_equal(evt, expected, "driver event %d, %d expected", evt, expected);
+}
+
+/**
+ * @brief link_evt_expect; next link event of the type, quality polls in between are skipped
+ *
+ * @param type
+ * @param timeout_ms
+ * @param evt
+ */
+static void link_evt_expect(enum bluetooth_drv_link_evt_e type, uint32_t timeout_ms, struct bluetooth_drv_link_evt *evt)
+{
+    int64_t deadline = (k_uptime_get() + timeout_ms);
+
+    do
+    {
+        int64_t left = MAX((deadline - k_uptime_get()), 0);
+
+        zassert_ok(k_msgq_get(&link_evt_msgq, evt, K_MSEC(left)), "no link event %d within %u ms", type, timeout_ms);
+    } while ((evt->type == BT_LINK_EVT_QUALITY) && (type != BT_LINK_EVT_QUALITY));
+
+    zassert_equal(evt->type, type, "link event %d, %d expected", evt->type, type);
+}
+
+/**
+ * @brief peers_expect; the emulated peers, as advertised and in RSSI order
+ *
+ * @param since uptime before the scan, every record must be newer
+ */
+static void peers_expect(uint32_t since)
+{
+    struct bluetooth_peers peers[BLUETOOTH_DRV_MAX_PEERS];
+    uint16_t n = bluetooth_drv_peers_snapshot(peers, ARRAY_SIZE(peers));
+
+    zassert_equal(n, ARRAY_SIZE(emul_peers), "%u peers", n);
+    for (uint16_t i = 0; i < n; i++)
+    {
+        zassert_equal(strcmp(peers[i].addr, emul_peers[i].addr), 0, "peer %u address %s", i, peers[i].addr);
+        zassert_equal(strcmp(peers[i].name, emul_peers[i].name), 0, "peer %u name %s", i, peers[i].name);
+        zassert_equal(peers[i].rssi, emul_peers[i].rssi, "peer %u rssi %d", i, peers[i].rssi);
+        zassert_true(peers[i].last_seen >= since, "peer %u not refreshed", i);
+    }
+}
+
+/**
+ * @brief peer_get; scanned peer by name
+ *
+ * @param name
+ * @param peer
+ */
+static void peer_get(const char *name, struct bluetooth_peers *peer)
+{
+    struct bluetooth_peers peers[BLUETOOTH_DRV_MAX_PEERS];
+    uint16_t n = bluetooth_drv_peers_snapshot(peers, ARRAY_SIZE(peers));
+
+    for (uint16_t i = 0; i < n; i++)
+    {
+        if (strcmp(peers[i].name, name) == 0)
+        {
+            *peer = peers[i];
+            return;
+        }
+    }
+    zassert_unreachable("%s not scanned", name);
+}
+
+/**
+ * @brief scan_wait; the emulator sends one record per scan interval
+ *
+ */
+static void scan_wait(void)
+{
+    k_sleep(K_MSEC((ARRAY_SIZE(emul_peers) * EMUL_SCAN_MS) + SLACK_MS));
+}
+
+static void *bt_emul_setup(void)
+{
+    zassert_ok(settings_subsys_init());
+    zassert_ok(bluetooth_emul_attach(uart, &emul_cfg));
+    zassert_ok(bluetooth_drv_link_subscribe(on_link_evt));
+
+    return NULL;
+}
+
+// The driver is configured once, tests run in name order from the link state left by the previous one
+
+ZTEST(bt_emul, test_1_boot)
+{
+    uint32_t start = k_uptime_get_32();
+
+    zassert_ok(bluetooth_drv_config(uart, on_drv_evt, BT103036C_CONFIG_TX));
+
+    // Unconfigured module, restored and rebooted once
+    int64_t boot_ms = bluetooth_drv_get_boot_ms();
+
+    zassert_between_inclusive(boot_ms, (2 * EMUL_BOOT_MS), ((2 * EMUL_BOOT_MS) + (BOOT_CMDS * EMUL_RESP_MS) + SLACK_MS),
+                              "boot in %d ms", (int)boot_ms);
+
+    // No cached peer, the driver falls back to a scan
+    drv_evt_expect(BT_EVT_SCANNING, (EMUL_RESP_MS + SLACK_MS));
+    scan_wait();
+    peers_expect(start);
+}
+
+ZTEST(bt_emul, test_2_connect_refused)
+{
+    struct bluetooth_peers peer;
+
+    peer_get("EMUL_FAR", &peer);
+
+    int64_t start = k_uptime_get();
+
+    zassert_ok(bluetooth_drv_connect(&peer));
+    drv_evt_expect(BT_EVT_CONN_FAILED, (EMUL_CONNECT_MS + SLACK_MS));
+
+    // Failure taken from the module status, not from the driver timeout
+    int64_t elapsed = (k_uptime_get() - start);
+
+    zassert_between_inclusive(elapsed, EMUL_CONNECT_MS, (EMUL_CONNECT_MS + SLACK_MS), "refused in %d ms", (int)elapsed);
+
+    scan_wait(); // The driver scans again after a failure
+}
+
+ZTEST(bt_emul, test_3_connect)
+{
+    struct bluetooth_peers peer;
+    struct bluetooth_drv_link_evt evt;
+    struct bluetooth_drv_link_stats stats;
+
+    peer_get("EMUL_SPK", &peer);
+
+    int64_t start = k_uptime_get();
+
+    zassert_ok(bluetooth_drv_connect(&peer));
+    link_evt_expect(BT_LINK_EVT_UP, (EMUL_CONNECT_MS + SLACK_MS), &evt);
+    drv_evt_expect(BT_EVT_CONNECTED, SLACK_MS);
+
+    int64_t elapsed = (k_uptime_get() - start);
+
+    zassert_between_inclusive(elapsed, EMUL_CONNECT_MS, (EMUL_CONNECT_MS + SLACK_MS), "connected in %d ms", (int)elapsed);
+
+    bluetooth_drv_link_get_stats(&stats);
+    zassert_true(stats.up);
+    zassert_equal(stats.reconnects, 0, "first link counted as a reconnection");
+}
+
+ZTEST(bt_emul, test_4_quality)
+{
+    struct bluetooth_drv_link_evt evt;
+    struct bluetooth_drv_link_stats stats;
+
+    link_evt_expect(BT_LINK_EVT_QUALITY, (LINK_POLL_MS + SLACK_MS), &evt);
+    zassert_equal(evt.rssi, emul_peers[1].rssi, "rssi %d", evt.rssi);
+
+    // Link index ahead of the value, the first poll after the change may still be in the old layout
+    emul_cfg.layout = BT_EMUL_LAYOUT_ADDR_FIRST;
+    link_evt_expect(BT_LINK_EVT_QUALITY, (LINK_POLL_MS + SLACK_MS), &evt);
+    link_evt_expect(BT_LINK_EVT_QUALITY, (LINK_POLL_MS + SLACK_MS), &evt);
+    zassert_equal(evt.rssi, emul_peers[1].rssi, "rssi %d", evt.rssi);
+
+    bluetooth_drv_link_get_stats(&stats);
+    zassert_equal(stats.rssi, emul_peers[1].rssi);
+}
+
+ZTEST(bt_emul, test_5_scan_layout)
+{
+    uint32_t start = k_uptime_get_32();
+
+    // Address first, name before the RSSI
+    emul_cfg.layout = BT_EMUL_LAYOUT_ADDR_FIRST;
+    zassert_ok(bluetooth_drv_scan());
+    scan_wait();
+    peers_expect(start);
+
+    emul_cfg.layout = BT_EMUL_LAYOUT_INDEX_FIRST;
+}
+
+ZTEST(bt_emul, test_6_link_drop)
+{
+    struct bluetooth_drv_link_evt evt;
+    struct bluetooth_drv_link_stats stats;
+
+    zassert_ok(bluetooth_emul_link_drop(EMUL_DROP_MS));
+    link_evt_expect(BT_LINK_EVT_DOWN, (EMUL_RESP_MS + SLACK_MS), &evt);
+
+    // AUTOCONN brings the link back
+    link_evt_expect(BT_LINK_EVT_UP, (EMUL_DROP_MS + SLACK_MS), &evt);
+    zassert_between_inclusive(evt.down_ms, EMUL_DROP_MS, (EMUL_DROP_MS + SLACK_MS), "down for %u ms", evt.down_ms);
+
+    bluetooth_drv_link_get_stats(&stats);
+    zassert_true(stats.up);
+    zassert_equal(stats.reconnects, 1);
+    zassert_equal(stats.last_down_ms, evt.down_ms);
+    zassert_equal(stats.max_down_ms, evt.down_ms);
+}
+
+ZTEST(bt_emul, test_7_inject)
+{
+    static const char noise[] = "#\x7f!noise";
+    static const char head[] = "\r\n+A2DPSTAT=";
+    static const char tail[] = "1\r\n";
+    static const char back[] = "\r\n+A2DPSTAT=3\r\n";
+    struct bluetooth_drv_link_evt evt;
+    struct bluetooth_drv_link_stats stats;
+
+    // Right after a poll, no status query answers in between
+    link_evt_expect(BT_LINK_EVT_QUALITY, (LINK_POLL_MS + SLACK_MS), &evt);
+
+    // Line noise and a status split across two transfers
+    zassert_ok(bluetooth_emul_inject(noise, (sizeof(noise) - 1)));
+    zassert_ok(bluetooth_emul_inject(head, (sizeof(head) - 1)));
+    k_sleep(K_MSEC(SLACK_MS));
+
+    bluetooth_drv_link_get_stats(&stats);
+    zassert_true(stats.up, "partial line decoded");
+
+    zassert_ok(bluetooth_emul_inject(tail, (sizeof(tail) - 1)));
+    link_evt_expect(BT_LINK_EVT_DOWN, SLACK_MS, &evt);
+
+    zassert_ok(bluetooth_emul_inject(back, (sizeof(back) - 1)));
+    link_evt_expect(BT_LINK_EVT_UP, SLACK_MS, &evt);
+
+    bluetooth_drv_link_get_stats(&stats);
+    zassert_equal(stats.reconnects, 2);
+    zassert_equal(bluetooth_drv_rx_overruns(), 0);
+}
+
+ZTEST_SUITE(bt_emul, NULL, bt_emul_setup, NULL, NULL, NULL);
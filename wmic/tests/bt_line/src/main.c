@@ -0,0 +1,285 @@
+/*
+ * BT module line parser tests
+ * Transcript replay through the RX ring, field accessors, key lookup and
+ * parser throughput
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "bluetooth_line.h"
+#include "transcript.h"
+
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define RING_SIZE 128      // Small ring, lines wrap around often
+#define BENCH_RING_SIZE 512 // As the driver
+#define BENCH_CHUNK 64      // DMA chunk of the driver
+#define BENCH_RUNS 200
+#define LINE_SIZE 64
+
+struct replay
+{
+    uint8_t ring[BENCH_RING_SIZE];
+    uint16_t size;
+    uint16_t head;
+    uint16_t idx;
+    uint32_t lines;
+    uint32_t skipped;
+    char line[ARRAY_SIZE(transcript_lines)][LINE_SIZE];
+};
+
+static struct replay replay;
+
+// Key table, values as filled by the driver handlers
+static int32_t val_int[4];
+static char val_str[32];
+static uint32_t val_calls;
+
+static void on_int(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size)
+{
+    ARG_UNUSED(size);
+
+    *(int32_t *)arg = bluetooth_line_int(line, val);
+    val_calls++;
+}
+
+static void on_str(const struct bluetooth_line *line, uint16_t val, void *arg, size_t size)
+{
+    bluetooth_line_field(line, val, BLUETOOTH_LINE_WHOLE, arg, size);
+    val_calls++;
+}
+
+static const struct bluetooth_line_key keys[] = {
+    {"+A2DP", on_int, &val_int[0], 0},
+    {"+A2DPSTAT", on_int, &val_int[1], 0},
+    {"+NAME", on_str, val_str, sizeof(val_str)},
+    {"+RSSI", on_int, &val_int[2], 0},
+    {"+SCAN", on_int, &val_int[3], 0},
+};
+
+/**
+ * @brief replay_put; bytes written in the ring as the DMA does, then decoded
+ *
+ * @param r
+ * @param data
+ * @param len
+ * @param keep framed lines are stored for the checks
+ */
+static void replay_put(struct replay *r, const char *data, uint16_t len, bool keep)
+{
+    uint16_t unread = ((r->head + r->size - r->idx) % r->size);
+
+    zassert_true((unread + len) < r->size, "ring overrun in the test itself");
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        r->ring[r->head] = (uint8_t)data[i];
+        r->head = ((r->head + 1) % r->size);
+    }
+
+    struct bluetooth_line line;
+    enum bluetooth_line_next_e next;
+
+    while ((next = bluetooth_line_next(r->ring, r->size, &r->idx, r->head, &line)) != BT_LINE_NONE)
+    {
+        if (next == BT_LINE_SKIPPED)
+        {
+            r->skipped++;
+            continue;
+        }
+
+        if (keep && (r->lines < ARRAY_SIZE(transcript_lines)))
+        {
+            bluetooth_line_field(&line, 0, BLUETOOTH_LINE_WHOLE, r->line[r->lines], LINE_SIZE);
+        }
+        else
+        {
+            uint16_t key_len = bluetooth_line_key_len(&line);
+            const struct bluetooth_line_key *entry = bluetooth_line_key_find(&line, key_len, keys, ARRAY_SIZE(keys));
+
+            if (entry != NULL)
+            {
+                entry->handler(&line, (key_len + 1), entry->arg, entry->size);
+            }
+        }
+        r->lines++;
+    }
+}
+
+/**
+ * @brief replay_transcript; whole transcript in chunks of the given size
+ *
+ * @param r
+ * @param chunk
+ * @param keep
+ */
+static void replay_transcript(struct replay *r, uint16_t chunk, bool keep)
+{
+    uint16_t len = (sizeof(transcript) - 1);
+
+    for (uint16_t i = 0; i < len; i += chunk)
+    {
+        replay_put(r, &transcript[i], MIN(chunk, (len - i)), keep);
+    }
+}
+
+/**
+ * @brief line_frame; one line framed from a ring filled by hand
+ *
+ * @param ring
+ * @param size
+ * @param from ring offset of the \r\n
+ * @param text
+ * @param line
+ */
+static void line_frame(uint8_t *ring, uint16_t size, uint16_t from, const char *text, struct bluetooth_line *line)
+{
+    char packet[LINE_SIZE];
+    uint16_t len = snprintf(packet, sizeof(packet), "\r\n%s\r\n", text);
+    uint16_t idx = from;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        ring[(from + i) % size] = (uint8_t)packet[i];
+    }
+
+    zassert_equal(bluetooth_line_next(ring, size, &idx, ((from + len) % size), line), BT_LINE_FRAMED);
+    zassert_equal(bluetooth_line_len(line), strlen(text));
+}
+
+ZTEST(bt_line, test_transcript_chunks)
+{
+    static const uint16_t chunks[] = {1, 2, 5, 17, 31, 64};
+
+    for (uint8_t c = 0; c < ARRAY_SIZE(chunks); c++)
+    {
+        // Every start offset, so that each line wraps around at some point
+        for (uint16_t start = 0; start < RING_SIZE; start += 7)
+        {
+            memset(&replay, 0, sizeof(replay));
+            replay.size = RING_SIZE;
+            replay.head = start;
+            replay.idx = start;
+
+            replay_transcript(&replay, chunks[c], true);
+
+            zassert_equal(replay.lines, ARRAY_SIZE(transcript_lines), "chunk %u start %u: %u lines", chunks[c], start, replay.lines);
+            zassert_true(replay.skipped > 0, "line noise not skipped");
+            for (uint8_t i = 0; i < ARRAY_SIZE(transcript_lines); i++)
+            {
+                zassert_equal(strcmp(replay.line[i], transcript_lines[i]), 0, "chunk %u start %u line %u: %s", chunks[c], start, i, replay.line[i]);
+            }
+        }
+    }
+}
+
+ZTEST(bt_line, test_partial_line)
+{
+    static const char part[] = "\r\n+RSSI=-5";
+    struct bluetooth_line line;
+    uint8_t ring[RING_SIZE];
+    uint16_t idx = 0;
+
+    memcpy(ring, part, (sizeof(part) - 1));
+    zassert_equal(bluetooth_line_next(ring, sizeof(ring), &idx, (sizeof(part) - 1), &line), BT_LINE_NONE);
+    zassert_equal(idx, 0, "partial line consumed");
+}
+
+ZTEST(bt_line, test_fields)
+{
+    static uint8_t ring[RING_SIZE];
+    struct bluetooth_line line;
+    char out[LINE_SIZE];
+
+    // Value wrapped around the ring end, digits on both spans
+    line_frame(ring, sizeof(ring), (RING_SIZE - 12), "+SCAN=0,1,-62,A1B2C3D4E5F6,Desk Speaker", &line);
+    zassert_true(line.len[1] > 0, "line not wrapped");
+
+    uint16_t val = (bluetooth_line_key_len(&line) + 1);
+
+    zassert_equal(bluetooth_line_int(&line, bluetooth_line_field_pos(&line, val, 2)), -62);
+    bluetooth_line_field(&line, val, 3, out, sizeof(out));
+    zassert_equal(strcmp(out, "A1B2C3D4E5F6"), 0, "%s", out);
+    bluetooth_line_field(&line, val, 4, out, sizeof(out));
+    zassert_equal(strcmp(out, "Desk Speaker"), 0, "%s", out);
+    bluetooth_line_field(&line, val, 5, out, sizeof(out));
+    zassert_equal(strcmp(out, ""), 0, "field past the end: %s", out);
+    bluetooth_line_field(&line, val, BLUETOOTH_LINE_WHOLE, out, 6);
+    zassert_equal(strcmp(out, "0,1,-"), 0, "truncation: %s", out);
+
+    zassert_true(bluetooth_line_equals(&line, 0, 5, "+SCAN"));
+    zassert_false(bluetooth_line_equals(&line, 0, 4, "+SCAN"));
+    zassert_false(bluetooth_line_equals(&line, 0, 6, "+SCAN"));
+}
+
+ZTEST(bt_line, test_key_lookup)
+{
+    static uint8_t ring[RING_SIZE];
+    struct bluetooth_line line;
+
+    memset(val_int, 0, sizeof(val_int));
+    val_calls = 0;
+
+    line_frame(ring, sizeof(ring), 0, "+A2DPSTAT=3", &line);
+    const struct bluetooth_line_key *entry = bluetooth_line_key_find(&line, bluetooth_line_key_len(&line), keys, ARRAY_SIZE(keys));
+
+    // Prefix of another key must not match
+    zassert_not_null(entry);
+    zassert_equal(strcmp(entry->key, "+A2DPSTAT"), 0, "%s", entry->key);
+
+    line_frame(ring, sizeof(ring), 40, "+A2DPSTATX=1", &line);
+    zassert_is_null(bluetooth_line_key_find(&line, bluetooth_line_key_len(&line), keys, ARRAY_SIZE(keys)));
+
+    line_frame(ring, sizeof(ring), 70, "OK", &line);
+    zassert_equal(bluetooth_line_key_len(&line), 2);
+    zassert_is_null(bluetooth_line_key_find(&line, 2, keys, ARRAY_SIZE(keys)));
+
+    // Handlers through the transcript
+    memset(&replay, 0, sizeof(replay));
+    replay.size = RING_SIZE;
+    replay_transcript(&replay, 13, false);
+
+    zassert_equal(val_int[1], 3, "+A2DPSTAT %d", val_int[1]);
+    zassert_equal(val_int[2], -58, "+RSSI %d", val_int[2]);
+    zassert_equal(strcmp(val_str, "WMIC,TX"), 0, "+NAME %s", val_str);
+    zassert_equal(val_calls, 6);
+}
+
+ZTEST(bt_line, test_bench)
+{
+#if defined(CONFIG_BOARD_NATIVE_SIM)
+    ztest_test_skip(); // Virtual time, the numbers come from the target
+#endif
+
+    timing_t start;
+    timing_t end;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.size = BENCH_RING_SIZE;
+
+    timing_init();
+    timing_start();
+
+    start = timing_counter_get();
+    for (uint16_t i = 0; i < BENCH_RUNS; i++)
+    {
+        replay_transcript(&replay, BENCH_CHUNK, false);
+    }
+    end = timing_counter_get();
+
+    uint64_t ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+    uint64_t bytes = ((uint64_t)BENCH_RUNS * (sizeof(transcript) - 1));
+
+    timing_stop();
+
+    zassert_equal(replay.lines, (BENCH_RUNS * ARRAY_SIZE(transcript_lines)));
+    TC_PRINT("%u lines, %u bytes: %u ns/line, %u kB/s\n", replay.lines, (uint32_t)bytes,
+             (uint32_t)(ns / replay.lines), (uint32_t)((bytes * 1000000ULL) / MAX(ns, 1)));
+}
+
+ZTEST_SUITE(bt_line, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,57 @@
+/*
+ * BT module session transcript
+ * Boot check, settings queries, scan, A2DP connection and link poll, in
+ * the framing of the module UART: every line is sent as \r\n<line>\r\n.
+ * A burst of line noise is left between two records.
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#ifndef TRANSCRIPT_H
+#define TRANSCRIPT_H
+
+static const char transcript[] =
+    "\r\n+NAME=WMIC,TX\r\n"
+    "\r\nOK\r\n"
+    "\r\n+PROFILE=64\r\n"
+    "\r\nOK\r\n"
+    "\r\n+I2SCFG=71\r\n"
+    "\r\nOK\r\n"
+    "\r\n+AUTOCONN=64\r\n"
+    "\r\nOK\r\n"
+    "\r\nOK\r\n"
+    "\r\n+SCAN=0,1,-62,A1B2C3D4E5F6,Kitchen\r\n"
+    "\r\n+SCAN=0,2,-80,0011223344AA,Desk Speaker\r\n"
+    "#\x7f!noise"
+    "\r\nOK\r\n"
+    "\r\n+A2DPSTAT=2\r\n"
+    "\r\n+A2DPSTAT=3\r\n"
+    "\r\n+RSSI=-58\r\n"
+    "\r\nOK\r\n"
+    "\r\nERROR\r\n"
+    "\r\n+UNKNOWN=1\r\n";
+
+// Lines framed out of the transcript, in order
+static const char *const transcript_lines[] = {
+    "+NAME=WMIC,TX",
+    "OK",
+    "+PROFILE=64",
+    "OK",
+    "+I2SCFG=71",
+    "OK",
+    "+AUTOCONN=64",
+    "OK",
+    "OK",
+    "+SCAN=0,1,-62,A1B2C3D4E5F6,Kitchen",
+    "+SCAN=0,2,-80,0011223344AA,Desk Speaker",
+    "OK",
+    "+A2DPSTAT=2",
+    "+A2DPSTAT=3",
+    "+RSSI=-58",
+    "OK",
+    "ERROR",
+    "+UNKNOWN=1",
+};
+
+#endif // TRANSCRIPT_H
@@ -0,0 +1,280 @@
+/*
+ * Smooth gain and delay tests
+ * Gain ramps and saturation, crossfaded delay changes and the ADT effect
+ * driven by a 200 Hz sine through delay and mix changes, no step in the
+ * output may be larger than the sine itself plus the fade slope
+ * Author: Andrea Fato
+ * Rev: 1.0
+ * Date: 19/10/2026
+ */
+
+#include "adt.h"
+#include "smooth.h"
+
+#include <zephyr/ztest.h>
+#include <zephyr/timing/timing.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK 441 // Frames per block of the audio thread, 10 ms at 44.1 kHz
+#define RATE 44100
+#define TONE_HZ 200
+#define AMP (0.5 * 2147483647.0) // Half full scale
+#define SETTLE_BLOCKS 60         // ADT delay line filled by then (500 ms)
+#define LINE_SIZE 4096
+#define BENCH_RUNS 100
+
+// Largest step of the sine, the fade slope adds at most 2 * AMP per fade length
+#define TONE_STEP ((int64_t)(AMP * 2 * M_PI * TONE_HZ / RATE))
+#define CLICK_LIMIT (TONE_STEP + (int64_t)((2 * AMP) / SMOOTH_XFADE_LEN))
+
+struct tone
+{
+    uint32_t k;    // Samples generated
+    q31_t prev;    // Last output sample
+    int64_t jump;  // Largest output step seen
+    bool watch;    // Steps are tracked
+};
+
+static q31_t in[BLOCK];
+static q31_t out[BLOCK];
+static q31_t line[LINE_SIZE];
+
+/**
+ * @brief tone_sample
+ *
+ * @param k
+ * @return q31_t
+ */
+static q31_t tone_sample(uint32_t k)
+{
+    return (q31_t)(AMP * sin((2 * M_PI * TONE_HZ * k) / RATE));
+}
+
+/**
+ * @brief tone_fill; next block of the sine
+ *
+ * @param t
+ * @param buf
+ * @param n
+ */
+static void tone_fill(struct tone *t, q31_t *buf, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        buf[i] = tone_sample(t->k++);
+    }
+}
+
+/**
+ * @brief tone_watch; largest step of an output block, across blocks too
+ *
+ * @param t
+ * @param buf
+ * @param n
+ */
+static void tone_watch(struct tone *t, const q31_t *buf, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        int64_t jump = llabs((int64_t)buf[i] - t->prev);
+
+        if (t->watch && (jump > t->jump))
+        {
+            t->jump = jump;
+        }
+        t->prev = buf[i];
+    }
+}
+
+ZTEST(dsp_smooth, test_gain_ramp)
+{
+    struct smooth_gain g;
+    q31_t dc = (SMOOTH_GAIN_UNITY / 2);
+
+    for (uint32_t i = 0; i < BLOCK; i++)
+    {
+        in[i] = dc;
+    }
+
+    // Ramp across the block, chunk boundaries included
+    smooth_gain_init(&g, 0);
+    smooth_gain_set(&g, SMOOTH_GAIN_UNITY);
+    smooth_gain_apply(&g, in, out, BLOCK);
+
+    zassert_true(out[0] <= ((dc / BLOCK) + 2), "first sample %d", out[0]);
+    for (uint32_t i = 1; i < BLOCK; i++)
+    {
+        zassert_true(out[i] >= out[i - 1], "ramp not monotonic at %u", i);
+        zassert_true((out[i] - out[i - 1]) <= ((dc / BLOCK) + 2), "ramp step at %u", i);
+    }
+    zassert_within(out[BLOCK - 1], dc, (dc / BLOCK) + 2, "ramp end %d", out[BLOCK - 1]);
+    zassert_equal(g.cur, SMOOTH_GAIN_UNITY);
+
+    // Steady afterwards, the value the ramp ended on
+    q31_t end = out[BLOCK - 1];
+
+    smooth_gain_apply(&g, in, out, BLOCK);
+    for (uint32_t i = 0; i < BLOCK; i++)
+    {
+        zassert_within(out[i], end, (dc / BLOCK) + 2, "steady sample %u: %d", i, out[i]);
+    }
+}
+
+ZTEST(dsp_smooth, test_gain_mac)
+{
+    struct smooth_gain g;
+    static q31_t acc[BLOCK];
+
+    for (uint32_t i = 0; i < BLOCK; i++)
+    {
+        in[i] = (SMOOTH_GAIN_UNITY / 2);
+        acc[i] = 0x70000000;
+    }
+
+    // Gain held at zero leaves the accumulator alone
+    smooth_gain_init(&g, 0);
+    smooth_gain_mac(&g, in, acc, BLOCK);
+    for (uint32_t i = 0; i < BLOCK; i++)
+    {
+        zassert_equal(acc[i], 0x70000000, "acc touched at %u", i);
+    }
+
+    // Sum past full scale saturates, never wraps
+    smooth_gain_set(&g, SMOOTH_GAIN_UNITY);
+    smooth_gain_mac(&g, in, acc, BLOCK);
+    for (uint32_t i = 1; i < BLOCK; i++)
+    {
+        zassert_true(acc[i] >= acc[i - 1], "acc wrapped at %u", i);
+    }
+    zassert_equal(acc[BLOCK - 1], INT32_MAX);
+
+    // Steady gain, same sum again
+    smooth_gain_mac(&g, in, acc, BLOCK);
+    zassert_equal(acc[0], INT32_MAX);
+}
+
+ZTEST(dsp_smooth, test_delay_change)
+{
+    struct smooth_delay d;
+    struct tone t = {0};
+    uint32_t delay = 100;
+
+    smooth_delay_init(&d, line, LINE_SIZE, 1000);
+
+    // Line filled, then a long to short change
+    for (uint8_t b = 0; b < 4; b++)
+    {
+        tone_fill(&t, in, BLOCK);
+        smooth_delay_process(&d, in, out, BLOCK);
+        tone_watch(&t, out, BLOCK);
+    }
+
+    t.watch = true;
+    smooth_delay_set(&d, delay);
+    for (uint8_t b = 0; b < 4; b++)
+    {
+        tone_fill(&t, in, BLOCK);
+        smooth_delay_process(&d, in, out, BLOCK);
+        tone_watch(&t, out, BLOCK);
+    }
+
+    zassert_true(t.jump <= CLICK_LIMIT, "step %lld over %lld", t.jump, CLICK_LIMIT);
+    zassert_equal(d.xfade_pos, SMOOTH_XFADE_LEN, "crossfade still running");
+
+    // Fade over, the new tap exactly
+    for (uint32_t i = 0; i < BLOCK; i++)
+    {
+        zassert_equal(out[i], tone_sample(t.k - BLOCK + i - delay), "sample %u", i);
+    }
+}
+
+ZTEST(dsp_smooth, test_adt_changes)
+{
+    struct tone t = {0};
+
+    adt_init(500);
+    adt_set_mix(true, 1);
+
+    for (uint16_t b = 0; b < 400; b++)
+    {
+        switch (b)
+        {
+        case 100:
+            adt_set_delay(30);
+            break;
+        case 101:
+            adt_set_delay(200); // Queued while the first fade runs
+            break;
+        case 200:
+            adt_set_mix(true, 4);
+            break;
+        case 250:
+            adt_set_mix(false, 4);
+            break;
+        case 300:
+            adt_set_mix(true, 0);
+            break;
+        default:
+            break;
+        }
+
+        t.watch = (b > SETTLE_BLOCKS);
+        tone_fill(&t, in, BLOCK);
+        adt_process(in, out, BLOCK);
+        tone_watch(&t, out, BLOCK);
+    }
+
+    zassert_true(t.jump <= CLICK_LIMIT, "step %lld over %lld", t.jump, CLICK_LIMIT);
+}
+
+ZTEST(dsp_smooth, test_bench)
+{
+#if defined(CONFIG_QEMU_TARGET)
+    ztest_test_skip(); // Virtual time, the numbers come from the target
+#endif
+
+    struct tone t = {0};
+    timing_t start;
+    timing_t end;
+    uint64_t steady_ns;
+    uint64_t fade_ns;
+
+    adt_init(200);
+    adt_set_mix(true, 1);
+    tone_fill(&t, in, BLOCK);
+
+    timing_init();
+    timing_start();
+
+    // Gains and delay steady
+    adt_process(in, out, BLOCK);
+    start = timing_counter_get();
+    for (uint16_t i = 0; i < BENCH_RUNS; i++)
+    {
+        adt_process(in, out, BLOCK);
+    }
+    end = timing_counter_get();
+    steady_ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+    // Gain ramp and crossfade on every block
+    start = timing_counter_get();
+    for (uint16_t i = 0; i < BENCH_RUNS; i++)
+    {
+        adt_set_delay(((i & 1) != 0) ? 200 : 150);
+        adt_set_mix(true, ((i & 1) != 0) ? 1 : 2);
+        adt_process(in, out, BLOCK);
+    }
+    end = timing_counter_get();
+    fade_ns = timing_cycles_to_ns(timing_cycles_get(&start, &end));
+
+    timing_stop();
+
+    TC_PRINT("%u frames: steady %u us/block, changing %u us/block\n", BLOCK,
+             (uint32_t)(steady_ns / (BENCH_RUNS * 1000ULL)), (uint32_t)(fade_ns / (BENCH_RUNS * 1000ULL)));
+    zassert_true(fade_ns < (BENCH_RUNS * 10000000ULL), "slower than real time");
+}
+
+ZTEST_SUITE(dsp_smooth, NULL, NULL, NULL, NULL, NULL);